@@ -0,0 +1,39 @@
+#include "Allocations.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+static std::atomic<uint64_t> allocations(0);
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+// The replaceable global forms, the rest of them end up in these
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// Counts every operator new in the program, so a check can show that a stage doesn't allocate
+uint64_t allocationCount();
@@ -0,0 +1,42 @@
+#include "Bones.h"
+
+#define bit(joint) (1u << (joint))
+
+// Directions as the JSON has always had them
+const BoneChain boneChains[BONE_CHAIN_COUNT] = {
+    { { JOINT_HAND_LEFT, JOINT_ELBOW_LEFT, JOINT_SHOULDER_LEFT, JOINT_SHOULDER_CENTER },
+        bit(JOINT_HAND_LEFT) | bit(JOINT_ELBOW_LEFT) | bit(JOINT_SHOULDER_LEFT) | bit(JOINT_SHOULDER_CENTER) },
+    { { JOINT_SHOULDER_CENTER, JOINT_SHOULDER_RIGHT, JOINT_ELBOW_RIGHT, JOINT_HAND_RIGHT },
+        bit(JOINT_SHOULDER_CENTER) | bit(JOINT_SHOULDER_RIGHT) | bit(JOINT_ELBOW_RIGHT) | bit(JOINT_HAND_RIGHT) },
+    { { JOINT_HEAD, JOINT_SHOULDER_CENTER, JOINT_SPINE, JOINT_HIP_CENTER },
+        bit(JOINT_HEAD) | bit(JOINT_SHOULDER_CENTER) | bit(JOINT_SPINE) | bit(JOINT_HIP_CENTER) },
+    { { JOINT_FOOT_LEFT, JOINT_KNEE_LEFT, JOINT_HIP_LEFT, JOINT_HIP_CENTER },
+        bit(JOINT_FOOT_LEFT) | bit(JOINT_KNEE_LEFT) | bit(JOINT_HIP_LEFT) | bit(JOINT_HIP_CENTER) },
+    { { JOINT_HIP_CENTER, JOINT_HIP_RIGHT, JOINT_KNEE_RIGHT, JOINT_FOOT_RIGHT },
+        bit(JOINT_HIP_CENTER) | bit(JOINT_HIP_RIGHT) | bit(JOINT_KNEE_RIGHT) | bit(JOINT_FOOT_RIGHT) },
+};
+
+void buildBoneStrokes(const BodyStore& store, BoneStrokes& out) {
+    int n = 0;
+    for (int b = 0; b < store.count; b++) {
+        out.bodyStart[b] = n;
+        uint32_t found = store.found[b];
+        for (int c = 0; c < BONE_CHAIN_COUNT; c++) {
+            const BoneChain& chain = boneChains[c];
+            if ((found & chain.mask) == chain.mask) {
+                out.strokes[n++] = { (uint8_t)b, (uint8_t)c, 0, BONE_CHAIN_LENGTH };
+                continue;
+            }
+            if (!(found & chain.mask)) continue;
+            // Split at the joints that are missing, a lone joint has nothing to draw
+            int first = 0;
+            for (int i = 0; i <= BONE_CHAIN_LENGTH; i++) {
+                if (i < BONE_CHAIN_LENGTH && (found & bit(chain.joints[i]))) continue;
+                if (i - first >= 2) out.strokes[n++] = { (uint8_t)b, (uint8_t)c, (uint8_t)first, (uint8_t)(i - first) };
+                first = i + 1;
+            }
+        }
+    }
+    out.bodyStart[store.count] = n;
+    out.count = n;
+}
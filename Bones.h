@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Frames.h"
+#include "Skeletons.h"
+
+// The lines drawn between joints, as a table of chains. Every frame the chains are cut down to the
+// runs of joints the sensor found, once, and both the preview and the JSON output draw that list.
+
+#define BONE_CHAIN_COUNT 5
+#define BONE_CHAIN_LENGTH 4
+
+struct BoneChain {
+    JointIndex joints[BONE_CHAIN_LENGTH];   // In the order the stroke is drawn
+    uint32_t mask;                          // Bit per joint
+};
+
+extern const BoneChain boneChains[BONE_CHAIN_COUNT];
+
+// A run of at least two found joints along one chain
+struct BoneStroke {
+    uint8_t body;       // Index in the body store
+    uint8_t chain;
+    uint8_t first;      // Into the chain's joints
+    uint8_t length;
+};
+
+// The strokes of every active body, grouped by body in store order
+struct BoneStrokes {
+    int count = 0;
+    int bodyStart[SKELETON_COUNT + 1];      // Body b's strokes are [bodyStart[b], bodyStart[b + 1])
+    BoneStroke strokes[SKELETON_COUNT * BONE_CHAIN_COUNT];
+};
+
+// A chain with all its joints found is one stroke, otherwise every longest run of found joints is.
+// The masks come from store.found, so the same list fits any store with the same bodies.
+void buildBoneStrokes(const BodyStore& store, BoneStrokes& out);
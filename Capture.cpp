@@ -0,0 +1,121 @@
+#include "Capture.h"
+
+#include "CpuTime.h"
+
+// How long a wait may block before the thread checks whether it should stop
+#define captureWaitMs 100
+
+CaptureThread::CaptureThread(FrameSource* source, int sensor) : source(source),
+    sensor(sensor),
+    recorder(NULL),
+    depthSequence(0),
+    colorSequence(0),
+    skeletonSequence(0),
+    cpu(0),
+    publishedSkeleton(0),
+    running(false) {
+    for (int i = 0; i < 3; i++) {
+        subscribers[i] = 0;
+        lastFrameNumber[i] = 0;
+        droppedFrames[i] = 0;
+    }
+}
+
+CaptureThread::~CaptureThread() {
+    stop();
+}
+
+void CaptureThread::start() {
+    if (running) return;
+    running = true;
+    thread = std::thread(&CaptureThread::run, this);
+}
+
+void CaptureThread::stop() {
+    running = false;
+    if (thread.joinable()) thread.join();
+}
+
+void CaptureThread::subscribe(int streams) {
+    if (streams & STREAM_DEPTH) subscribers[0]++;
+    if (streams & STREAM_COLOR) subscribers[1]++;
+    if (streams & STREAM_SKELETON) subscribers[2]++;
+}
+
+void CaptureThread::unsubscribe(int streams) {
+    if (streams & STREAM_DEPTH) subscribers[0]--;
+    if (streams & STREAM_COLOR) subscribers[1]--;
+    if (streams & STREAM_SKELETON) subscribers[2]--;
+}
+
+uint64_t CaptureThread::waitForSkeleton(uint64_t sequence, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(publishMutex);
+    skeletonPublished.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&] { return publishedSkeleton > sequence; });
+    return publishedSkeleton;
+}
+
+uint64_t CaptureThread::dropped(int stream) const {
+    return droppedFrames[stream == STREAM_DEPTH ? 0 : stream == STREAM_COLOR ? 1 : 2];
+}
+
+void CaptureThread::countDropped(int index, uint32_t frameNumber) {
+    uint32_t& last = lastFrameNumber[index];
+    // A playback that starts over goes back to lower numbers, that's no drop
+    if (last && frameNumber > last + 1) droppedFrames[index] += frameNumber - last - 1;
+    last = frameNumber;
+}
+
+int CaptureThread::wanted() const {
+    return (subscribers[0] > 0 ? STREAM_DEPTH : 0) |
+        (subscribers[1] > 0 ? STREAM_COLOR : 0) |
+        (subscribers[2] > 0 ? STREAM_SKELETON : 0);
+}
+
+void CaptureThread::run() {
+    while (running.load(std::memory_order_relaxed)) {
+        int ready = source->waitForFrames(captureWaitMs);
+        int unwanted = ready & ~wanted();
+        if (unwanted) {
+            source->skipFrames(unwanted);
+            // Skipped on purpose, the next frame read starts the count over
+            if (unwanted & STREAM_DEPTH) lastFrameNumber[0] = 0;
+            if (unwanted & STREAM_COLOR) lastFrameNumber[1] = 0;
+            if (unwanted & STREAM_SKELETON) lastFrameNumber[2] = 0;
+        }
+        ready &= ~unwanted;
+        int64_t now = steadyMicros();
+
+        if ((ready & STREAM_DEPTH) && source->readDepth(depth.writeBuffer())) {
+            depth.writeBuffer().sensor = sensor;
+            depth.writeBuffer().sequence = ++depthSequence;
+            depth.writeBuffer().captureMicros = now;
+            countDropped(0, depth.writeBuffer().frameNumber);
+            if (recorder) recorder->writeDepth(depth.writeBuffer());
+            depth.publish();
+        }
+        if ((ready & STREAM_COLOR) && source->readColor(color.writeBuffer())) {
+            color.writeBuffer().sensor = sensor;
+            color.writeBuffer().sequence = ++colorSequence;
+            color.writeBuffer().captureMicros = now;
+            countDropped(1, color.writeBuffer().frameNumber);
+            if (recorder) recorder->writeColor(color.writeBuffer());
+            color.publish();
+        }
+        if ((ready & STREAM_SKELETON) && source->readSkeleton(skeleton.writeBuffer())) {
+            SkeletonFrame& frame = skeleton.writeBuffer();
+            frame.sensor = sensor;
+            for (int b = 0; b < SKELETON_COUNT; b++) frame.bodies[b].sensor = sensor;
+            frame.sequence = ++skeletonSequence;
+            frame.captureMicros = now;
+            countDropped(2, frame.frameNumber);
+            if (recorder) recorder->writeSkeleton(frame);
+            skeleton.publish();
+            {
+                std::lock_guard<std::mutex> lock(publishMutex);
+                publishedSkeleton = skeletonSequence;
+            }
+            skeletonPublished.notify_all();
+        }
+        cpu.store(threadCpuMicros(), std::memory_order_relaxed);
+    }
+}
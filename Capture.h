@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Frames.h"
+#include "FrameSource.h"
+#include "Recording.h"
+#include "TripleBuffer.h"
+
+// Dedicated thread that waits on a frame source and publishes every frame it gets
+// into a triple buffer, so the render loop and the JSON stage never wait on the sensor.
+class CaptureThread {
+public:
+    // Frames are tagged with the sensor index
+    CaptureThread(FrameSource* source, int sensor);
+    ~CaptureThread();
+
+    void start();
+    void stop();
+
+    // Also write every captured frame to the recorder, set before start()
+    void record(Recorder* recorder) { this->recorder = recorder; }
+
+    // Consumers register the STREAM_* bits they read and drop them when they stop.
+    // Frames of streams nobody reads are released at the source without being copied.
+    void subscribe(int streams);
+    void unsubscribe(int streams);
+
+    // Blocks until a skeleton frame newer than sequence is published or the timeout runs out,
+    // returns the sequence of the newest published one
+    uint64_t waitForSkeleton(uint64_t sequence, int timeoutMs);
+
+    // Frames of one STREAM_* the source skipped, found by gaps in its frame numbers while the stream was read
+    uint64_t dropped(int stream) const;
+
+    // CPU time the thread has used so far
+    int64_t cpuMicros() const { return cpu; }
+
+    TripleBuffer<DepthFrame> depth;
+    TripleBuffer<ColorFrame> color;
+    TripleBuffer<SkeletonFrame> skeleton;
+
+private:
+    void run();
+    int wanted() const;
+    void countDropped(int index, uint32_t frameNumber);
+
+    FrameSource* source;
+    int sensor;
+    Recorder* recorder;
+    uint64_t depthSequence;
+    uint64_t colorSequence;
+    uint64_t skeletonSequence;
+    std::atomic<int> subscribers[3];    // Depth, color, skeleton
+    uint32_t lastFrameNumber[3];        // 0 when unknown, like after the stream was skipped
+    std::atomic<uint64_t> droppedFrames[3];
+    std::atomic<int64_t> cpu;
+    std::mutex publishMutex;
+    std::condition_variable skeletonPublished;
+    uint64_t publishedSkeleton;
+    std::thread thread;
+    std::atomic<bool> running;
+};
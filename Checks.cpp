@@ -0,0 +1,597 @@
+#include "Checks.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "json.hpp"
+
+#include "Allocations.h"
+#include "Geometry.h"
+#include "OsciBinary.h"
+#include "OsciJson.h"
+#include "Pipeline.h"
+#include "SyntheticSource.h"
+
+using json = nlohmann::json;
+
+// The body counts the synthetic scenes run with
+static const int sceneBodies[] = { 1, 2, 6 };
+
+static StreamSettings skeletonsOnly() {
+    StreamSettings streams;
+    streams.depth = streams.color = RESOLUTION_OFF;
+    return streams;
+}
+
+// Unpaced synthetic skeleton frames of count bodies into a fresh body store, drawn with every
+// primitive. What the checks run the output pipeline on.
+struct SyntheticScene {
+    SyntheticSource source;
+    SkeletonFrame skeleton;
+
+    SyntheticScene(int count) : source(count, 0, skeletonsOnly()) {
+        headCube = headIco = handCube = footCube = true;
+        bodies = BodyStore();
+    }
+
+    // The next frame into skeleton
+    void read() {
+        source.waitForFrames(0);
+        source.readSkeleton(skeleton);
+    }
+
+    // skeleton through the body store and into the next geometry frame, turning the primitives a
+    // frame's worth if spin
+    const FrameGeometry& draw(bool spin) {
+        getSkeletonData(skeleton);
+        if (spin) spinPrimitives(1.f / 30);
+        makeGeometry();
+        return geometryFrames[geometryFrame];
+    }
+};
+
+static void printStage(const char* name, std::vector<double>& us) {
+    std::sort(us.begin(), us.end());
+    size_t n = us.size();
+    printf("%-10s %10.2f %10.2f %10.2f\n", name, us[n / 2], us[std::min(n - 1, n * 99 / 100)], us[n - 1]);
+}
+
+int benchReplay(int frames) {
+    playbackSpeed = 0;
+    playbackLoop = true;
+    syntheticFps = 0;
+    if (!playbackPath && syntheticBodies < 0) syntheticBodies = 2;
+    FrameSource* source = openSource(0);
+    if (!source) return 1;
+
+    // Keep the primitives moving so every frame's output changes
+    handCube = footCube = true;
+    const glm::vec3 spin = { 0.05f, 0.03f, 0.02f };
+
+    typedef std::chrono::steady_clock clock;
+    std::vector<double> readUs, skeletonUs, geometryUs, serializeUs, totalUs;
+    readUs.reserve(frames);
+    skeletonUs.reserve(frames);
+    geometryUs.reserve(frames);
+    serializeUs.reserve(frames);
+    totalUs.reserve(frames);
+    static SkeletonFrame skeleton;
+    DepthFrame depth;
+    ColorFrame color;
+    std::string out;
+    uint64_t bytes = 0;
+    int sent = 0, maxBodies = 0, idle = 0;
+
+    clock::time_point benchStart = clock::now();
+    while ((int)totalUs.size() < frames) {
+        clock::time_point t0 = clock::now();
+        int ready = source->waitForFrames(100);
+        if (!ready && ++idle > 10) break;
+        // Image frames still get read, their cost is part of keeping up with the sensor
+        if (ready & STREAM_DEPTH) source->readDepth(depth);
+        if (ready & STREAM_COLOR) source->readColor(color);
+        if (!(ready & STREAM_SKELETON) || !source->readSkeleton(skeleton)) continue;
+        idle = 0;
+        clock::time_point t1 = clock::now();
+
+        getSkeletonData(skeleton);
+        clock::time_point t2 = clock::now();
+
+        headCubeRotation += spin;
+        headIcoRotation += spin;
+        handCubeRotationL += spin;
+        handCubeRotationR -= spin;
+        footCubeRotationL += spin;
+        footCubeRotationR -= spin;
+        makeGeometry();
+        clock::time_point t3 = clock::now();
+
+        if (serializeOsciRender(out)) {
+            bytes += out.size();
+            sent++;
+        }
+        clock::time_point t4 = clock::now();
+
+        if (activeSkeletons > maxBodies) maxBodies = activeSkeletons;
+        readUs.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        skeletonUs.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+        geometryUs.push_back(std::chrono::duration<double, std::micro>(t3 - t2).count());
+        serializeUs.push_back(std::chrono::duration<double, std::micro>(t4 - t3).count());
+        totalUs.push_back(std::chrono::duration<double, std::micro>(t4 - t0).count());
+    }
+    double seconds = std::chrono::duration<double>(clock::now() - benchStart).count();
+    delete source;
+
+    int n = (int)totalUs.size();
+    if (n == 0) {
+        printf("No skeleton frames to replay\n");
+        return 1;
+    }
+    printf("Replayed %d frames in %.3f s, %.1f frames/s, up to %d bodies\n", n, seconds, n / seconds, maxBodies);
+    printf("%-10s %10s %10s %10s\n", "stage", "p50 us", "p99 us", "max us");
+    printStage("read", readUs);
+    printStage("skeleton", skeletonUs);
+    printStage("geometry", geometryUs);
+    printStage("serialize", serializeUs);
+    printStage("total", totalUs);
+    printf("Serialized %llu bytes in %d messages, %.1f bytes/frame\n", (unsigned long long)bytes, sent, (double)bytes / n);
+    return 0;
+}
+
+int benchBodies(int frames) {
+    typedef std::chrono::steady_clock clock;
+    printf("%-8s %12s %12s %12s %12s %12s\n", "bodies", "store us", "geometry us", "serialize us", "total us", "bytes/frame");
+    bool ok = true;
+    for (int count : sceneBodies) {
+        SyntheticScene scene(count);
+        std::string out;
+        double storeUs = 0, geometryUs = 0, serializeUs = 0;
+        uint64_t bytes = 0;
+        // Label each tracking ID got the first time it was seen
+        int labels[SKELETON_COUNT + 1] = { 0 };
+
+        for (int f = 0; f < frames; f++) {
+            scene.read();
+            clock::time_point t0 = clock::now();
+            getSkeletonData(scene.skeleton);
+            clock::time_point t1 = clock::now();
+            spinPrimitives(1.f / 30);
+            makeGeometry();
+            clock::time_point t2 = clock::now();
+            if (serializeOsciRender(out)) bytes += out.size();
+            clock::time_point t3 = clock::now();
+
+            storeUs += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            geometryUs += std::chrono::duration<double, std::micro>(t2 - t1).count();
+            serializeUs += std::chrono::duration<double, std::micro>(t3 - t2).count();
+
+            if (bodies.count != count) ok = false;
+            for (int b = 0; b < bodies.count; b++) {
+                uint32_t id = bodies.trackingId[b];
+                if (id > SKELETON_COUNT) ok = false;
+                else if (!labels[id]) labels[id] = bodies.label[b];
+                else if (labels[id] != bodies.label[b]) ok = false;
+            }
+        }
+        printf("%-8d %12.2f %12.2f %12.2f %12.2f %12.1f\n", count, storeUs / frames, geometryUs / frames,
+            serializeUs / frames, (storeUs + geometryUs + serializeUs) / frames, (double)bytes / frames);
+    }
+    printf("Body identity %s\n", ok ? "ok" : "MISMATCH");
+    return ok ? 0 : 1;
+}
+
+// The output bodies of the last makeGeometry() drawn into geometry until it is full, one object
+// each with all of the primitives and the last object over and over. Checks that every stroke is
+// one of its body's strokes, only the last cut short, so nothing was joined onto another stroke.
+static bool fillGeometry(FrameGeometry& geometry) {
+    static FrameGeometry single;
+    const BodyStore& out = outputBodies();
+    geometry.clear();
+    bool full = out.count == 0;
+    for (int o = 0; !full; o++) {
+        int b = o % out.count;
+        glm::vec4 sp[JOINT_COUNT];
+        bodyPoints(out, b, sp);
+        if (!geometry.beginObject(out.label[b])) break;
+        full = !skeletate(geometry, sp, b, primitives, 0, primitives.count);
+        while (!full && o == MAX_GEOMETRY_OBJECTS - 1) full = !skeletate(geometry, sp, b, primitives, 0, primitives.count);
+
+        single.clear();
+        single.beginObject(out.label[b]);
+        skeletate(single, sp, b, primitives, 0, primitives.count);
+        const GeometryObject& object = geometry.objects[o];
+        for (int s = object.firstStroke; s < geometry.objects[o + 1].firstStroke; s++) {
+            int r = (s - object.firstStroke) % single.strokeCount;
+            int length = geometry.strokeStart[s + 1] - geometry.strokeStart[s];
+            int expected = single.strokeStart[r + 1] - single.strokeStart[r];
+            bool last = s == geometry.strokeCount - 1;
+            if (length > expected || (length < expected && !last)) return false;
+            for (int i = 0; i < length; i++) {
+                int v = geometry.strokeStart[s] + i, w = single.strokeStart[r] + i;
+                if (geometry.x[v] != single.x[w] || geometry.y[v] != single.y[w] || geometry.z[v] != single.z[w]) return false;
+            }
+        }
+    }
+    return geometry.strokeCount == MAX_GEOMETRY_STROKES || geometry.vertexCount == MAX_GEOMETRY_VERTICES;
+}
+
+// The same JSON down to numbers within tolerance of each other
+static bool closeJson(const json& a, const json& b, double tolerance) {
+    if (a.is_number() && b.is_number()) return fabs(a.get<double>() - b.get<double>()) <= tolerance;
+    if (a.type() != b.type() || a.size() != b.size()) return false;
+    if (a.is_array()) {
+        for (size_t i = 0; i < a.size(); i++) {
+            if (!closeJson(a[i], b[i], tolerance)) return false;
+        }
+        return true;
+    }
+    if (a.is_object()) {
+        for (auto item = a.begin(); item != a.end(); ++item) {
+            if (!b.contains(item.key()) || !closeJson(item.value(), b[item.key()], tolerance)) return false;
+        }
+        return true;
+    }
+    return a == b;
+}
+
+int benchJson(int frames) {
+    float grid = gridMm;
+    gridMm = 0;
+
+    typedef std::chrono::steady_clock clock;
+    printf("%-8s %12s %14s %14s %10s %12s %12s %12s\n", "bodies", "bytes/frame", "tree MB/s", "writer MB/s", "speedup",
+        "writer us", "grid bytes", "grid us");
+    static FrameGeometry onGrid;
+    int mismatches = 0, gridMismatches = 0;
+    uint64_t checked = 0, identical = 0;
+    for (int count : sceneBodies) {
+        SyntheticScene scene(count);
+        std::string tree, written;
+        double treeSeconds = 0, writerSeconds = 0, gridSeconds = 0;
+        uint64_t bytes = 0, gridBytes = 0;
+
+        for (int f = 0; f < frames; f++) {
+            scene.read();
+            const FrameGeometry& geometry = scene.draw(true);
+            bool frameInfo = f % 2 == 1;
+            sendFrameInfo = frameInfo;
+
+            clock::time_point t0 = clock::now();
+            geometryJson(geometry, tree);
+            clock::time_point t1 = clock::now();
+            writeScene(geometry, frameInfo, written);
+            clock::time_point t2 = clock::now();
+
+            treeSeconds += std::chrono::duration<double>(t1 - t0).count();
+            writerSeconds += std::chrono::duration<double>(t2 - t1).count();
+            bytes += written.size();
+
+            copyGeometry(onGrid, geometry);
+            t0 = clock::now();
+            quantizeGeometry(onGrid, 0.0005f);
+            writeScene(onGrid, frameInfo, written);
+            t1 = clock::now();
+            gridSeconds += std::chrono::duration<double>(t1 - t0).count();
+            gridBytes += written.size();
+            std::string gridTree;
+            geometryJson(onGrid, gridTree);
+            if (!closeJson(json::parse(written), json::parse(gridTree), 1e-6) && gridMismatches++ == 0) {
+                printf("Frame %d with %d bodies on the grid reads back differently:\n  tree  %.100s\n  fixed %.100s\n",
+                    f, count, gridTree.c_str(), written.c_str());
+            }
+
+            writeScene(geometry, frameInfo, written);
+            checked++;
+            if (written == tree) {
+                identical++;
+                continue;
+            }
+            if (json::parse(written) == json::parse(tree)) continue;
+            if (mismatches++ == 0) {
+                size_t at = 0;
+                while (at < tree.size() && at < written.size() && tree[at] == written[at]) at++;
+                printf("First mismatch at byte %zu:\n  tree   %.60s\n  writer %.60s\n", at,
+                    tree.c_str() + (at > 20 ? at - 20 : 0), written.c_str() + (at > 20 ? at - 20 : 0));
+            }
+        }
+        sendFrameInfo = false;
+        printf("%-8d %12.1f %14.1f %14.1f %9.1fx %12.2f %12.1f %12.2f\n", count, (double)bytes / frames,
+            bytes / treeSeconds / 1e6, bytes / writerSeconds / 1e6, treeSeconds / writerSeconds,
+            writerSeconds * 1e6 / frames, (double)gridBytes / frames, gridSeconds * 1e6 / frames);
+    }
+    gridMm = grid;
+
+    // The last frame drawn again until the geometry is full, with and without the grid
+    static FrameGeometry full;
+    std::string tree, written;
+    if (!fillGeometry(full)) mismatches++;
+    for (int k = 0; k < 2; k++) {
+        quantizeGeometry(full, k ? 0.0005f : 0);
+        geometryJson(full, tree);
+        writeScene(full, false, written);
+        checked++;
+        if (written == tree) identical++;
+        else if (!closeJson(json::parse(written), json::parse(tree), k ? 1e-6 : 0)) {
+            printf("The full geometry frame%s reads back differently\n", k ? " on the grid" : "");
+            if (k) gridMismatches++;
+            else mismatches++;
+        }
+    }
+    printf("%llu of %llu frames byte for byte the same, %d that read back differently, %d on the grid\n",
+        (unsigned long long)identical, (unsigned long long)checked, mismatches, gridMismatches);
+    return mismatches || gridMismatches ? 1 : 0;
+}
+
+int benchGrid(int frames) {
+    const float grids[] = { 0, 0.1f, 0.25f, 0.5f, 1, 2, 5 };
+    const float noiseMm = 2;
+    SyntheticScene scene(2);
+    scene.read();
+    std::vector<SkeletonFrame> recorded(frames, scene.skeleton);
+    for (int f = 0; f < frames; f++) recorded[f].timestamp = scene.skeleton.timestamp + f * 33;
+    addJointNoise(recorded, noiseMm);
+
+    float configured = gridMm;
+    typedef std::chrono::steady_clock clock;
+    static FrameGeometry exact;
+    std::string out;
+    const char* filters[] = { "unfiltered", "after the One-Euro filter", "after the double exponential filter" };
+    printf("%d frames of 2 still bodies with %.1f mm of noise, %s\n", frames, noiseMm, filters[jointFilterSettings.type]);
+    printf("%-10s %10s %12s %12s %12s %14s\n", "grid mm", "frames %", "vertices %", "bytes/frame", "serialize us", "snap error mm");
+    for (float grid : grids) {
+        gridMm = grid;
+        bodies = BodyStore();
+        jointFilter.reset();
+        history.reset();
+        int changed = 0;
+        uint64_t vertices = 0, movedVertices = 0;
+        double bytes = 0, seconds = 0;
+        float snapError = 0;
+        for (int f = 0; f < frames; f++) {
+            getSkeletonData(recorded[f]);
+            makeGeometry();
+            const FrameGeometry& geometry = geometryFrames[geometryFrame];
+            // The first frames are the filter settling
+            if (f < 30) continue;
+            // The body labels and strokes stay the same, so the vertices line up
+            const FrameGeometry& before = geometryFrames[!geometryFrame];
+            for (int i = 0; i < geometry.vertexCount; i++) {
+                bool moved = grid > 0 ?
+                    geometry.qx[i] != before.qx[i] || geometry.qy[i] != before.qy[i] || geometry.qz[i] != before.qz[i] :
+                    geometry.x[i] != before.x[i] || geometry.y[i] != before.y[i] || geometry.z[i] != before.z[i];
+                if (moved) movedVertices++;
+            }
+            vertices += geometry.vertexCount;
+            if (!geometryChanged) continue;
+            changed++;
+            clock::time_point t0 = clock::now();
+            writeScene(geometry, false, out);
+            seconds += std::chrono::duration<double>(clock::now() - t0).count();
+            bytes += out.size();
+        }
+        // How far the last frame moved to the grid, against its own vertices off it
+        gridMm = 0;
+        makeGeometry();
+        copyGeometry(exact, geometryFrames[geometryFrame]);
+        quantizeGeometry(exact, grid / 1000);
+        for (int i = 0; i < exact.vertexCount; i++) {
+            const FrameGeometry& g = geometryFrames[geometryFrame];
+            snapError = std::max(snapError, glm::length(glm::vec3(exact.x[i] - g.x[i], exact.y[i] - g.y[i], exact.z[i] - g.z[i])));
+        }
+        int n = std::max(changed, 1);
+        printf("%-10.2f %10.1f %12.1f %12.0f %12.2f %14.3f\n", grid, 100.0 * changed / (frames - 30),
+            100.0 * movedVertices / std::max(vertices, (uint64_t)1), bytes / n, seconds * 1e6 / n, snapError * 1000);
+    }
+    gridMm = configured;
+    return 0;
+}
+
+int benchBinary(int frames) {
+    typedef std::chrono::steady_clock clock;
+    static BinaryScene decodedScene;
+    std::string text, binary;
+    int failures = 0;
+    float halfError = 0;
+    printf("%-8s %26s %26s %26s\n", "", "JSON", "binary f32", "binary f16");
+    printf("%-8s", "bodies");
+    for (int k = 0; k < 3; k++) printf(" %8s %8s %8s", "bytes", "write us", "read us");
+    printf("\n");
+    for (int count : sceneBodies) {
+        SyntheticScene scene(count);
+        double bytes[3] = {}, writeUs[3] = {}, readUs[3] = {};
+
+        for (int f = 0; f < frames; f++) {
+            scene.read();
+            const FrameGeometry& geometry = scene.draw(true);
+            bool frameInfo = f % 2 == 1;
+
+            clock::time_point t0 = clock::now();
+            writeScene(geometry, frameInfo, text);
+            clock::time_point t1 = clock::now();
+            json parsed = json::parse(text);
+            clock::time_point t2 = clock::now();
+            bytes[0] += text.size();
+            writeUs[0] += std::chrono::duration<double, std::micro>(t1 - t0).count();
+            readUs[0] += std::chrono::duration<double, std::micro>(t2 - t1).count();
+
+            for (int k = 1; k < 3; k++) {
+                BinaryPrecision precision = k == 1 ? BINARY_FLOAT32 : BINARY_FLOAT16;
+                t0 = clock::now();
+                writeBinaryScene(geometry, skeletonMatrix, frameInfo, precision, f, binary);
+                t1 = clock::now();
+                int64_t length = readBinaryScene(binary.data(), binary.size(), NULL, decodedScene);
+                t2 = clock::now();
+                bytes[k] += binary.size();
+                writeUs[k] += std::chrono::duration<double, std::micro>(t1 - t0).count();
+                readUs[k] += std::chrono::duration<double, std::micro>(t2 - t1).count();
+
+                const FrameGeometry& decoded = decodedScene.geometry;
+                bool ok = length == (int64_t)binary.size() && decoded.objectCount == geometry.objectCount &&
+                    decoded.strokeCount == geometry.strokeCount && decoded.vertexCount == geometry.vertexCount &&
+                    !memcmp(decoded.objects, geometry.objects, (geometry.objectCount + 1) * sizeof(GeometryObject)) &&
+                    !memcmp(decoded.strokeStart, geometry.strokeStart, (geometry.strokeCount + 1) * sizeof(int)) &&
+                    (!frameInfo || (decoded.frameNumber == geometry.frameNumber && decoded.timestamp == geometry.timestamp)) &&
+                    (geometry.objectCount == 0 || !memcmp(decodedScene.matrix[0], skeletonMatrix, sizeof(skeletonMatrix)));
+                if (precision == BINARY_FLOAT32) ok = ok && sameGeometry(decoded, geometry);
+                else if (ok) {
+                    for (int i = 0; i < geometry.vertexCount; i++) {
+                        halfError = std::max(halfError, fabsf(decoded.x[i] - geometry.x[i]));
+                        halfError = std::max(halfError, fabsf(decoded.y[i] - geometry.y[i]));
+                        halfError = std::max(halfError, fabsf(decoded.z[i] - geometry.z[i]));
+                    }
+                }
+                // A message split across reads has to wait for the rest of it
+                const size_t splits[] = { 1, OSCI_BINARY_PREFIX_BYTES - 1, OSCI_BINARY_PREFIX_BYTES, OSCI_BINARY_PREFIX_BYTES + 1,
+                    binary.size() / 2, binary.size() - 1 };
+                for (size_t split : splits) ok = ok && readBinaryScene(binary.data(), split, NULL, decodedScene) == 0;
+                if (!ok && failures++ == 0) printf("Frame %d with %d bodies doesn't read back as %s\n", f, count, k == 1 ? "f32" : "f16");
+            }
+        }
+        printf("%-8d", count);
+        for (int k = 0; k < 3; k++) printf(" %8.0f %8.2f %8.2f", bytes[k] / frames, writeUs[k] / frames, readUs[k] / frames);
+        printf("\n");
+    }
+    printf("Largest f16 error %.2f mm, %d frames that didn't read back\n", halfError * 1000, failures);
+    // Half floats step 2^-11 of the magnitude, a few mm at the distances the scene has
+    return failures > 0 || halfError > 0.01f ? 1 : 0;
+}
+
+// The same scene, down to the frame info and every object's matrix
+static bool sameScene(const BinaryScene& a, const BinaryScene& b) {
+    const FrameGeometry& g = a.geometry;
+    const FrameGeometry& h = b.geometry;
+    return sameGeometry(g, h) && g.frameNumber == h.frameNumber && g.timestamp == h.timestamp &&
+        g.latencyMs == h.latencyMs && a.focalLength == b.focalLength &&
+        !memcmp(a.matrix, b.matrix, g.objectCount * sizeof(a.matrix[0]));
+}
+
+int checkDelta(int frames) {
+    const char* motions[] = { "moving", "still", "frozen" };
+    const int interval = 30;
+
+    static BinaryScene keyScene, deltaScenes[2], lateScenes[2];
+    static DeltaEncoder encoder;
+    std::string keyframe, delta;
+    int failures = 0;
+    printf("%-6s %-8s %-8s %12s %12s %8s %10s\n", "bodies", "motion", "vertices", "keyframe B", "delta B", "ratio", "late sync");
+    for (int k = 0; k < 2; k++) {
+        BinaryPrecision precision = k == 0 ? BINARY_FLOAT32 : BINARY_FLOAT16;
+        printf("%s\n", k == 0 ? "f32" : "f16");
+        for (int count : sceneBodies) {
+            for (int motion = 0; motion < 3; motion++) {
+                SyntheticScene scene(count);
+                encoder.reset();
+                double keyBytes = 0, deltaBytes = 0;
+                int current = 0, late = 0, lateSync = -1;
+                bool haveLate = false;
+
+                for (int f = 0; f < frames; f++) {
+                    if (motion == 0 || f == 0) scene.read();
+                    const FrameGeometry& drawn = scene.draw(motion != 2);
+                    bool idle = f % 97 == 50;
+                    const FrameGeometry& geometry = idle ? idleGeometry() : drawn;
+                    const float* matrix = idle ? idleMatrix : skeletonMatrix;
+                    bool frameInfo = !idle && f % 2 == 1;
+
+                    writeBinaryScene(geometry, matrix, frameInfo, precision, f, keyframe);
+                    encoder.write(geometry, matrix, frameInfo, precision, interval, delta);
+                    keyBytes += keyframe.size();
+                    deltaBytes += delta.size();
+
+                    bool ok = readBinaryScene(keyframe.data(), keyframe.size(), NULL, keyScene) == (int64_t)keyframe.size();
+                    ok = ok && readBinaryScene(delta.data(), delta.size(), f > 0 ? &deltaScenes[current] : NULL, deltaScenes[!current]) == (int64_t)delta.size();
+                    current = !current;
+                    ok = ok && sameScene(keyScene, deltaScenes[current]);
+
+                    if (f >= 5) {
+                        int64_t length = readBinaryScene(delta.data(), delta.size(), haveLate ? &lateScenes[late] : NULL, lateScenes[!late]);
+                        if (length > 0) {
+                            late = !late;
+                            haveLate = true;
+                            if (lateSync < 0) lateSync = f;
+                            ok = ok && sameScene(keyScene, lateScenes[late]);
+                        }
+                        else ok = ok && length == BINARY_NO_BASE && !haveLate;
+                    }
+                    if (!ok && failures++ == 0) printf("Frame %d of %d %s bodies decodes differently\n", f, count, motions[motion]);
+                }
+                printf("%-6d %-8s %8d %12.0f %12.0f %7.1fx %10d\n", count, motions[motion], geometryFrames[geometryFrame].vertexCount,
+                    keyBytes / frames, deltaBytes / frames, keyBytes / deltaBytes, lateSync);
+                if (frames > interval + 5 && lateSync < 0) failures++;
+            }
+        }
+    }
+    printf("%d frames that decoded differently\n", failures);
+    return failures > 0 ? 1 : 0;
+}
+
+int checkAllocations(int frames) {
+    const int warmup = 10;
+    SyntheticScene scene(SKELETON_COUNT);
+    interpolation = INTERPOLATE_CATMULL_ROM;
+    prediction.enabled = true;
+
+    std::string out;
+    uint64_t skeletonAllocations = 0, geometryAllocations = 0, serializeAllocations = 0;
+    for (int f = 0; f < warmup + frames; f++) {
+        scene.read();
+        uint64_t a0 = allocationCount();
+        getSkeletonData(scene.skeleton);
+        uint64_t a1 = allocationCount();
+        spinPrimitives(1.f / 30);
+        makeGeometry();
+        uint64_t a2 = allocationCount();
+        serializeOsciRender(out);
+        uint64_t a3 = allocationCount();
+        if (f < warmup) continue;
+        skeletonAllocations += a1 - a0;
+        geometryAllocations += a2 - a1;
+        serializeAllocations += a3 - a2;
+    }
+    printf("Heap allocations per frame: skeleton %.2f, geometry %.2f, serialize %.2f\n",
+        (double)skeletonAllocations / frames, (double)geometryAllocations / frames, (double)serializeAllocations / frames);
+    bool ok = skeletonAllocations == 0 && geometryAllocations == 0 && serializeAllocations == 0;
+    printf("Skeleton, geometry and serialize stages %s\n", ok ? "allocate nothing" : "ALLOCATE");
+
+    // A full geometry frame, the second time once the output has grown to it
+    static FrameGeometry full;
+    bool filled = true;
+    uint64_t fullAllocations = 0;
+    for (int k = 0; k < 2; k++) {
+        uint64_t a0 = allocationCount();
+        filled = fillGeometry(full) && filled;
+        writeScene(full, true, out);
+        fullAllocations = allocationCount() - a0;
+    }
+    printf("Full geometry frame, %d strokes and %d vertices: %s, %llu heap allocations\n", full.strokeCount, full.vertexCount,
+        filled ? "strokes kept apart" : "STROKES JOINED", (unsigned long long)fullAllocations);
+    ok = ok && filled && fullAllocations == 0;
+    return ok ? 0 : 1;
+}
+
+int benchFilters(int frames) {
+    playbackSpeed = 0;
+    syntheticFps = 0;
+    if (!playbackPath && syntheticBodies < 0) syntheticBodies = 2;
+    FrameSource* source = openSource(0);
+    if (!source) return 1;
+    bool ok = benchJointFilters(source, frames, playbackPath ? 0 : 5, jointFilterSettings);
+    delete source;
+    return ok ? 0 : 1;
+}
+
+int benchPredict(int frames) {
+    playbackSpeed = 0;
+    syntheticFps = 0;
+    if (!playbackPath && syntheticBodies < 0) syntheticBodies = 2;
+    FrameSource* source = openSource(0);
+    if (!source) return 1;
+    bool ok = benchPrediction(source, frames, playbackPath ? 0 : 5, jointFilterSettings);
+    delete source;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// The benchmarks and checks the command line runs in place of the viewer. Each drives the output
+// pipeline in main.cpp with no window, GL or socket, prints what it found and returns the exit
+// code, 1 if a check failed or there were no frames.
+
+// Pushes skeleton frames from the playback or synthetic source through the output pipeline
+// without pacing and reports throughput and per stage latency
+int benchReplay(int frames);
+
+// Runs frames unpaced synthetic skeleton frames with 1, 2 and 6 bodies through the body store,
+// geometry and serialization and reports the mean time of each. The bodies get moved between
+// skeleton slots on the way, so this also checks that each keeps its label.
+int benchBodies(int frames);
+
+// Serializes frames synthetic frames with 1, 2 and 6 bodies and every primitive, with and
+// without the frame info, through writeScene() and through the json tree it replaced. Checks
+// that the two give the same scene and reports the throughput of each. They can differ in the
+// last digit of a number, where std::to_chars rounds a tie to even and the json tree doesn't,
+// but both read back as the same double. Then snaps each frame to a 0.5 mm grid, writes it in
+// fixed point and checks that reads back as what the tree gives for it, to a float's precision.
+// A full geometry frame gets both comparisons too.
+int benchJson(int frames);
+
+// Runs frames copies of one synthetic frame of 2 bodies with noiseMm of noise on every joint, as
+// a performer standing still, through the filter and the output with the primitives not
+// spinning. For each grid, reports how many frames changed and would be sent, how many vertices
+// changed, which is what a delta sends, the JSON bytes and serialize time per frame sent and the
+// largest distance a vertex moved to the grid.
+int benchGrid(int frames);
+
+// Encodes frames synthetic frames with 1, 2 and 6 bodies and every primitive as JSON and as both
+// binary precisions, and decodes each the way a receiver would: json::parse() for the JSON and
+// readBinaryScene() for the binary. Checks that float32 reads back exactly and float16 to within
+// its precision, that a message cut short reads as not there yet, and reports the bytes and
+// microseconds per frame of each.
+int benchBinary(int frames);
+
+// Replays frames synthetic frames of 1, 2 and 6 bodies, moving, standing still with the
+// primitives spinning and frozen, with an idle frame now and then, in both precisions. Each
+// frame goes out as a keyframe and through a DeltaEncoder with a keyframe every 30 messages,
+// and the delta stream has to decode to exactly the scenes the keyframes do, for a receiver
+// there from the start and for one that joins at the sixth message.
+int checkDelta(int frames);
+
+// Runs frames synthetic skeleton frames with 6 bodies, every primitive, interpolation and
+// prediction through the skeleton, geometry and serialize stages and counts their heap
+// allocations once warmed up, then does the same for a full geometry frame and checks that
+// filling it joined no strokes. Fails if any of them allocate at all.
+int checkAllocations(int frames);
+
+// Runs the joint filters over recorded or synthetic skeleton frames, see benchJointFilters()
+int benchFilters(int frames);
+
+// Prediction error on recorded or synthetic skeleton frames, see benchPrediction()
+int benchPredict(int frames);
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// CPU time the calling thread has used so far, in microseconds.
+// Differences over a wall clock interval give the share of a core a stage takes.
+int64_t threadCpuMicros();
+
+// Monotonic wall clock in microseconds, the same on every thread
+int64_t steadyMicros();
@@ -0,0 +1,265 @@
+#include "DepthColor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define DEPTH_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Depth in millimeters is 13 bits, one LUT entry per possible value
+#define depthLutSize 8192
+
+static uint32_t depthLut[depthLutSize];
+static DepthColorSettings depthLutSettings;
+static bool depthLutValid = false;
+
+DepthKernel depthKernelBest() {
+#ifdef DEPTH_SIMD
+    static int best = -1;
+    if (best < 0) {
+        best = DEPTH_KERNEL_SSE2;
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] >= 7) {
+            __cpuid(info, 1);
+            bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            if (avx && (info[1] & (1 << 5))) best = DEPTH_KERNEL_AVX2;
+        }
+#else
+        if (__builtin_cpu_supports("avx2")) best = DEPTH_KERNEL_AVX2;
+#endif
+    }
+    return (DepthKernel)best;
+#else
+    return DEPTH_KERNEL_SCALAR;
+#endif
+}
+
+int depthColorRange(const DepthColorSettings& s) {
+    // The SIMD ramp needs its Q16 scale to fit 16 bits
+    int range = s.farMm - s.nearMm;
+    return range < 256 ? 256 : range >= depthLutSize ? depthLutSize - 1 : range;
+}
+
+static inline uint32_t gray(uint8_t v) {
+    return 0xff000000u | (v << 16) | (v << 8) | v;
+}
+
+static inline uint8_t rampValue(int depth, int nearMm, int range, uint32_t scale) {
+    uint32_t x = depth > nearMm ? depth - nearMm : 0;
+    if (x > (uint32_t)range) x = range;
+    return (uint8_t)(255 - ((x * scale) >> 16));
+}
+
+static void buildLut(const DepthColorSettings& s) {
+    int range = depthColorRange(s);
+    int band = s.bandMm < 1 ? 1 : s.bandMm;
+    uint32_t scale = (255u << 16) / range;
+
+    // Blue, cyan, green, yellow, red
+    static const uint8_t stops[5][3] = { { 255, 0, 0 }, { 255, 255, 0 }, { 0, 255, 0 }, { 0, 255, 255 }, { 0, 0, 255 } };
+
+    for (int d = 0; d < depthLutSize; d++) {
+        uint32_t color = 0xff000000u;
+        if (d == 0) depthLut[d] = color;
+        else if (s.colormap == DEPTH_GRAYSCALE) depthLut[d] = gray(rampValue(d, s.nearMm, range, scale));
+        else if (s.colormap == DEPTH_BANDED) {
+            int x = d > s.nearMm ? d - s.nearMm : 0;
+            depthLut[d] = gray((uint8_t)(255 - (x % band) * 255 / band));
+        }
+        else {
+            // False color, position along the ramp, 0 at near and 1024 at far
+            int x = d > s.nearMm ? d - s.nearMm : 0;
+            if (x > range) x = range;
+            int t = x * 1024 / range;
+            int stop = t >> 8;
+            if (stop > 3) stop = 3;
+            int f = t - (stop << 8);
+            for (int c = 0; c < 3; c++) {
+                int v = stops[stop][c] + ((stops[stop + 1][c] - stops[stop][c]) * f >> 8);
+                color |= (uint32_t)v << (8 * c);
+            }
+            depthLut[d] = color;
+        }
+    }
+    depthLutSettings = s;
+    depthLutValid = true;
+}
+
+static void convertScalar(const uint16_t* src, uint8_t* dest, int count, const DepthColorSettings& s) {
+    uint32_t* out = (uint32_t*)dest;
+    if (s.colormap == DEPTH_WRAP) {
+        for (int i = 0; i < count; i++) out[i] = gray((uint8_t)(src[i] >> 3));
+    }
+    else {
+        for (int i = 0; i < count; i++) out[i] = depthLut[src[i] >> 3];
+    }
+}
+
+#ifdef DEPTH_SIMD
+// 8 values in 16 bit lanes to 8 gray BGRA pixels
+static inline void storeGray8(uint8_t* dest, __m128i v) {
+    __m128i bg = _mm_or_si128(v, _mm_slli_epi16(v, 8));
+    __m128i ra = _mm_or_si128(v, _mm_set1_epi16((short)0xff00));
+    _mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi16(bg, ra));
+    _mm_storeu_si128((__m128i*)(dest + 16), _mm_unpackhi_epi16(bg, ra));
+}
+
+static int convertSse2(const uint16_t* src, uint8_t* dest, int count, const DepthColorSettings& s) {
+    int i = 0;
+    if (s.colormap == DEPTH_WRAP) {
+        const __m128i low = _mm_set1_epi16(0xff);
+        for (; i + 8 <= count; i += 8) {
+            __m128i p = _mm_loadu_si128((const __m128i*)(src + i));
+            storeGray8(dest + i * 4, _mm_and_si128(_mm_srli_epi16(p, 3), low));
+        }
+    }
+    else if (s.colormap == DEPTH_GRAYSCALE) {
+        int range = depthColorRange(s);
+        const __m128i nearMm = _mm_set1_epi16((short)s.nearMm);
+        const __m128i rangeMm = _mm_set1_epi16((short)range);
+        const __m128i scale = _mm_set1_epi16((short)((255u << 16) / range));
+        const __m128i white = _mm_set1_epi16(255);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 8 <= count; i += 8) {
+            __m128i d = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src + i)), 3);
+            __m128i x = _mm_min_epi16(_mm_subs_epu16(d, nearMm), rangeMm);
+            __m128i v = _mm_sub_epi16(white, _mm_mulhi_epu16(x, scale));
+            v = _mm_andnot_si128(_mm_cmpeq_epi16(d, zero), v);
+            storeGray8(dest + i * 4, v);
+        }
+    }
+    return i;
+}
+
+// 16 values in 16 bit lanes to 16 gray BGRA pixels
+TARGET_AVX2 static inline void storeGray16(uint8_t* dest, __m256i v) {
+    __m256i bg = _mm256_or_si256(v, _mm256_slli_epi16(v, 8));
+    __m256i ra = _mm256_or_si256(v, _mm256_set1_epi16((short)0xff00));
+    // Unpacks work within 128 bit lanes, put the pixels back in order
+    __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+    __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+    _mm256_storeu_si256((__m256i*)dest, _mm256_permute2x128_si256(lo, hi, 0x20));
+    _mm256_storeu_si256((__m256i*)(dest + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+TARGET_AVX2 static int convertAvx2(const uint16_t* src, uint8_t* dest, int count, const DepthColorSettings& s) {
+    int i = 0;
+    if (s.colormap == DEPTH_WRAP) {
+        const __m256i low = _mm256_set1_epi16(0xff);
+        for (; i + 16 <= count; i += 16) {
+            __m256i p = _mm256_loadu_si256((const __m256i*)(src + i));
+            storeGray16(dest + i * 4, _mm256_and_si256(_mm256_srli_epi16(p, 3), low));
+        }
+    }
+    else if (s.colormap == DEPTH_GRAYSCALE) {
+        int range = depthColorRange(s);
+        const __m256i nearMm = _mm256_set1_epi16((short)s.nearMm);
+        const __m256i rangeMm = _mm256_set1_epi16((short)range);
+        const __m256i scale = _mm256_set1_epi16((short)((255u << 16) / range));
+        const __m256i white = _mm256_set1_epi16(255);
+        const __m256i zero = _mm256_setzero_si256();
+        for (; i + 16 <= count; i += 16) {
+            __m256i d = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(src + i)), 3);
+            __m256i x = _mm256_min_epi16(_mm256_subs_epu16(d, nearMm), rangeMm);
+            __m256i v = _mm256_sub_epi16(white, _mm256_mulhi_epu16(x, scale));
+            v = _mm256_andnot_si256(_mm256_cmpeq_epi16(d, zero), v);
+            storeGray16(dest + i * 4, v);
+        }
+    }
+    else {
+        for (; i + 8 <= count; i += 8) {
+            __m256i idx = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+            idx = _mm256_srli_epi32(idx, 3);
+            _mm256_storeu_si256((__m256i*)(dest + i * 4), _mm256_i32gather_epi32((const int*)depthLut, idx, 4));
+        }
+    }
+    return i;
+}
+#endif
+
+void depthToBgra(const uint16_t* src, uint8_t* dest, int count, const DepthColorSettings& settings, DepthKernel kernel) {
+    if (settings.colormap != DEPTH_WRAP) {
+        if (!depthLutValid || memcmp(&depthLutSettings, &settings, sizeof(settings))) buildLut(settings);
+    }
+
+    int done = 0;
+#ifdef DEPTH_SIMD
+    if (kernel == DEPTH_KERNEL_AVX2) done = convertAvx2(src, dest, count, settings);
+    else if (kernel == DEPTH_KERNEL_SSE2) done = convertSse2(src, dest, count, settings);
+#endif
+    // Tail, and whatever the SIMD kernels don't handle
+    convertScalar(src + done, dest + done * 4, count - done, settings);
+}
+
+void depthToBgra(const uint16_t* src, uint8_t* dest, int count, const DepthColorSettings& settings) {
+    depthToBgra(src, dest, count, settings, depthKernelBest());
+}
+
+// The conversion loop as it was in getKinectDataDepth()
+static void depthToBgraOriginal(const uint16_t* curr, uint8_t* dest, int count) {
+    const uint16_t* dataEnd = curr + count;
+    while (curr < dataEnd) {
+        uint16_t depth = *curr++ >> 3;
+        for (int i = 0; i < 3; ++i)
+            *dest++ = (uint8_t)(depth % 256);
+        *dest++ = 0xff;
+    }
+}
+
+void depthTestPattern(uint16_t* dest, int w, int h) {
+    uint32_t seed = 1;
+    for (int i = 0; i < w * h; i++) {
+        seed = seed * 1664525 + 1013904223;
+        int depth = i < depthLutSize ? i : (i % w) * 6 + (seed >> 24);
+        if ((seed >> 8 & 63) == 0) depth = 0;
+        dest[i] = (uint16_t)(((depth & (depthLutSize - 1)) << 3) | (seed >> 29));
+    }
+}
+
+bool benchDepthColor(int iterations) {
+    const int w = 640, h = 480, count = w * h;
+    const char* colormapNames[] = { "wrap", "grayscale", "banded", "false color" };
+    const char* kernelNames[] = { "scalar", "sse2", "avx2" };
+
+    std::vector<uint16_t> src(count);
+    depthTestPattern(src.data(), w, h);
+    std::vector<uint8_t> expected(count * 4), out(count * 4);
+
+    typedef std::chrono::high_resolution_clock clock;
+    clock::time_point start = clock::now();
+    for (int n = 0; n < iterations; n++) depthToBgraOriginal(src.data(), expected.data(), count);
+    double original = std::chrono::duration<double, std::micro>(clock::now() - start).count() / iterations;
+    printf("%-12s %-7s %8.1f us/frame\n", "original", "", original);
+
+    bool ok = true;
+    int best = depthKernelBest();
+    for (int c = DEPTH_WRAP; c <= DEPTH_FALSE_COLOR; c++) {
+        DepthColorSettings settings;
+        settings.colormap = (DepthColormap)c;
+        if (c != DEPTH_WRAP) depthToBgra(src.data(), expected.data(), count, settings, DEPTH_KERNEL_SCALAR);
+
+        for (int k = DEPTH_KERNEL_SCALAR; k <= best; k++) {
+            memset(out.data(), 0, out.size());
+            start = clock::now();
+            for (int n = 0; n < iterations; n++) depthToBgra(src.data(), out.data(), count, settings, (DepthKernel)k);
+            double us = std::chrono::duration<double, std::micro>(clock::now() - start).count() / iterations;
+            bool match = out == expected;
+            ok = ok && match;
+            printf("%-12s %-7s %8.1f us/frame  %5.2fx  %s\n", colormapNames[c], kernelNames[k], us, original / us, match ? "ok" : "MISMATCH");
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+// Converts packed NUI depth pixels ((millimeters << 3) | player index) to BGRA for display.
+
+enum DepthColormap {
+    DEPTH_WRAP = 0,         // Millimeters modulo 256, the original view
+    DEPTH_GRAYSCALE,        // Linear ramp from white at nearMm to black at farMm
+    DEPTH_BANDED,           // Ramp repeating every bandMm, shows contours
+    DEPTH_FALSE_COLOR       // Blue to red over nearMm..farMm
+};
+
+enum DepthKernel {
+    DEPTH_KERNEL_SCALAR = 0,
+    DEPTH_KERNEL_SSE2,
+    DEPTH_KERNEL_AVX2
+};
+
+struct DepthColorSettings {
+    DepthColormap colormap = DEPTH_GRAYSCALE;
+    int nearMm = 500;
+    int farMm = 4500;
+    int bandMm = 250;
+};
+
+// Width of the near to far ramp actually used, the requested one clamped to what the kernels support
+int depthColorRange(const DepthColorSettings& settings);
+
+// Fastest kernel this CPU supports
+DepthKernel depthKernelBest();
+
+// Converts count pixels in one pass. Unknown depth (0) is drawn black in every mode but DEPTH_WRAP.
+// The LUT based colormaps are cached between calls, so only call this from one thread.
+void depthToBgra(const uint16_t* src, uint8_t* dest, int count, const DepthColorSettings& settings, DepthKernel kernel);
+void depthToBgra(const uint16_t* src, uint8_t* dest, int count, const DepthColorSettings& settings);
+
+// Fills a w x h frame with every depth value once, then a noisy ramp with holes and player indices
+void depthTestPattern(uint16_t* dest, int w, int h);
+
+// Times every kernel and colormap against the original per-pixel loop, and checks that
+// every kernel matches it exactly in DEPTH_WRAP and matches the scalar kernel in the others.
+// Returns false on a mismatch.
+bool benchDepthColor(int iterations);
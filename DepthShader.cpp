@@ -0,0 +1,255 @@
+#include "DepthShader.h"
+
+#include <stdio.h>
+#include <vector>
+
+#include <SDL3/SDL.h>
+
+// Entry points past GL 1.1 have to be looked up at runtime
+static struct {
+    PFNGLCREATESHADERPROC CreateShader;
+    PFNGLSHADERSOURCEPROC ShaderSource;
+    PFNGLCOMPILESHADERPROC CompileShader;
+    PFNGLGETSHADERIVPROC GetShaderiv;
+    PFNGLGETSHADERINFOLOGPROC GetShaderInfoLog;
+    PFNGLDELETESHADERPROC DeleteShader;
+    PFNGLCREATEPROGRAMPROC CreateProgram;
+    PFNGLATTACHSHADERPROC AttachShader;
+    PFNGLLINKPROGRAMPROC LinkProgram;
+    PFNGLGETPROGRAMIVPROC GetProgramiv;
+    PFNGLGETPROGRAMINFOLOGPROC GetProgramInfoLog;
+    PFNGLDELETEPROGRAMPROC DeleteProgram;
+    PFNGLUSEPROGRAMPROC UseProgram;
+    PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+    PFNGLUNIFORM1IPROC Uniform1i;
+    PFNGLGENFRAMEBUFFERSPROC GenFramebuffers;
+    PFNGLBINDFRAMEBUFFERPROC BindFramebuffer;
+    PFNGLFRAMEBUFFERTEXTURE2DPROC FramebufferTexture2D;
+    PFNGLCHECKFRAMEBUFFERSTATUSPROC CheckFramebufferStatus;
+    PFNGLDELETEFRAMEBUFFERSPROC DeleteFramebuffers;
+} gl;
+
+static GLuint program = 0;
+static GLint uniformColormap, uniformNear, uniformRange, uniformScale, uniformBand;
+
+static const char* vertexSource =
+    "#version 130\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    uv = gl_MultiTexCoord0.xy;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+// Integer math throughout so it matches depthToBgra() bit for bit
+static const char* fragmentSource =
+    "#version 130\n"
+    "uniform usampler2D depth;\n"
+    "uniform int colormap;\n"
+    "uniform int nearMm;\n"
+    "uniform int range;\n"
+    "uniform int scale;\n"
+    "uniform int band;\n"
+    "in vec2 uv;\n"
+    "out vec4 fragColor;\n"
+    "const ivec3 stops[5] = ivec3[5](ivec3(255, 0, 0), ivec3(255, 255, 0), ivec3(0, 255, 0), ivec3(0, 255, 255), ivec3(0, 0, 255));\n"
+    "void main() {\n"
+    "    int d = int(texture(depth, uv).r >> 3u);\n"
+    "    ivec3 bgr = ivec3(0);\n"
+    "    if (colormap == 0) bgr = ivec3(d & 255);\n"
+    "    else if (d != 0) {\n"
+    "        int x = max(d - nearMm, 0);\n"
+    "        if (colormap == 1) bgr = ivec3(255 - ((min(x, range) * scale) >> 16));\n"
+    "        else if (colormap == 2) bgr = ivec3(255 - (x % band) * 255 / band);\n"
+    "        else {\n"
+    "            int t = min(x, range) * 1024 / range;\n"
+    "            int stop = min(t >> 8, 3);\n"
+    "            int f = t - (stop << 8);\n"
+    "            bgr = stops[stop] + (((stops[stop + 1] - stops[stop]) * f) >> 8);\n"
+    "        }\n"
+    "    }\n"
+    "    fragColor = vec4(vec3(bgr.zyx), 255.0) / 255.0;\n"
+    "}\n";
+
+static GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = gl.CreateShader(type);
+    gl.ShaderSource(shader, 1, &source, NULL);
+    gl.CompileShader(shader);
+    GLint status = 0;
+    gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (!status) {
+        char log[1024];
+        gl.GetShaderInfoLog(shader, sizeof(log), NULL, log);
+        printf("Depth shader failed to compile: %s\n", log);
+        gl.DeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool initDepthShader() {
+    bool ok = true;
+#define loadGL(name) ok = ok && (*(void**)&gl.name = (void*)SDL_GL_GetProcAddress("gl" #name)) != NULL
+    loadGL(CreateShader);
+    loadGL(ShaderSource);
+    loadGL(CompileShader);
+    loadGL(GetShaderiv);
+    loadGL(GetShaderInfoLog);
+    loadGL(DeleteShader);
+    loadGL(CreateProgram);
+    loadGL(AttachShader);
+    loadGL(LinkProgram);
+    loadGL(GetProgramiv);
+    loadGL(GetProgramInfoLog);
+    loadGL(DeleteProgram);
+    loadGL(UseProgram);
+    loadGL(GetUniformLocation);
+    loadGL(Uniform1i);
+    loadGL(GenFramebuffers);
+    loadGL(BindFramebuffer);
+    loadGL(FramebufferTexture2D);
+    loadGL(CheckFramebufferStatus);
+    loadGL(DeleteFramebuffers);
+#undef loadGL
+    if (!ok) return false;
+
+    GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    if (!vertex || !fragment) return false;
+
+    program = gl.CreateProgram();
+    gl.AttachShader(program, vertex);
+    gl.AttachShader(program, fragment);
+    gl.LinkProgram(program);
+    gl.DeleteShader(vertex);
+    gl.DeleteShader(fragment);
+
+    GLint status = 0;
+    gl.GetProgramiv(program, GL_LINK_STATUS, &status);
+    if (!status) {
+        char log[1024];
+        gl.GetProgramInfoLog(program, sizeof(log), NULL, log);
+        printf("Depth shader failed to link: %s\n", log);
+        destroyDepthShader();
+        return false;
+    }
+
+    uniformColormap = gl.GetUniformLocation(program, "colormap");
+    uniformNear = gl.GetUniformLocation(program, "nearMm");
+    uniformRange = gl.GetUniformLocation(program, "range");
+    uniformScale = gl.GetUniformLocation(program, "scale");
+    uniformBand = gl.GetUniformLocation(program, "band");
+    return true;
+}
+
+void destroyDepthShader() {
+    if (program) gl.DeleteProgram(program);
+    program = 0;
+}
+
+GLuint createDepthTexture(int w, int h) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // Integer textures can't be filtered
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, w, h, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
+
+void uploadDepthTexture(GLuint texture, const uint16_t* pixels, int w, int h) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h, GL_RED_INTEGER, GL_UNSIGNED_SHORT, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void beginDepthShader(const DepthColorSettings& settings) {
+    int range = depthColorRange(settings);
+    gl.UseProgram(program);
+    gl.Uniform1i(uniformColormap, settings.colormap);
+    gl.Uniform1i(uniformNear, settings.nearMm);
+    gl.Uniform1i(uniformRange, range);
+    gl.Uniform1i(uniformScale, (int)((255u << 16) / range));
+    gl.Uniform1i(uniformBand, settings.bandMm < 1 ? 1 : settings.bandMm);
+}
+
+void endDepthShader() {
+    gl.UseProgram(0);
+}
+
+bool checkDepthShader() {
+    const int w = 640, h = 480;
+    const char* colormapNames[] = { "wrap", "grayscale", "banded", "false color" };
+
+    std::vector<uint16_t> src(w * h);
+    std::vector<uint8_t> expected(w * h * 4), out(w * h * 4);
+    depthTestPattern(src.data(), w, h);
+
+    GLuint depthTexture = createDepthTexture(w, h);
+    uploadDepthTexture(depthTexture, src.data(), w, h);
+
+    GLuint target, fbo;
+    glGenTextures(1, &target);
+    glBindTexture(GL_TEXTURE_2D, target);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+    gl.GenFramebuffers(1, &fbo);
+    gl.BindFramebuffer(GL_FRAMEBUFFER, fbo);
+    gl.FramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+
+    bool ok = gl.CheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    if (!ok) printf("Depth shader check: framebuffer incomplete\n");
+
+    // Same setup as the depth viewport
+    glViewport(0, 0, w, h);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, w, h, 0, 1, -1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+
+    for (int c = DEPTH_WRAP; c <= DEPTH_FALSE_COLOR && ok; c++) {
+        DepthColorSettings settings;
+        settings.colormap = (DepthColormap)c;
+
+        glBindTexture(GL_TEXTURE_2D, depthTexture);
+        beginDepthShader(settings);
+        glBegin(GL_QUADS);
+        glTexCoord2f(0.0f, 0.0f);
+        glVertex3f(0, 0, 0);
+        glTexCoord2f(1.0f, 0.0f);
+        glVertex3f((float)w, 0, 0);
+        glTexCoord2f(1.0f, 1.0f);
+        glVertex3f((float)w, (float)h, 0.0f);
+        glTexCoord2f(0.0f, 1.0f);
+        glVertex3f(0, (float)h, 0.0f);
+        glEnd();
+        endDepthShader();
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, w, h, GL_BGRA, GL_UNSIGNED_BYTE, out.data());
+        depthToBgra(src.data(), expected.data(), w * h, settings, DEPTH_KERNEL_SCALAR);
+
+        // The viewport is drawn top down, GL reads bottom up
+        int mismatches = 0;
+        for (int y = 0; y < h; y++) {
+            const uint8_t* a = out.data() + (h - 1 - y) * w * 4;
+            const uint8_t* b = expected.data() + y * w * 4;
+            for (int x = 0; x < w * 4; x += 4) {
+                if (a[x] != b[x] || a[x + 1] != b[x + 1] || a[x + 2] != b[x + 2]) mismatches++;
+            }
+        }
+        printf("%-12s %s (%d mismatched pixels)\n", colormapNames[c], mismatches ? "MISMATCH" : "ok", mismatches);
+        ok = mismatches == 0;
+    }
+
+    gl.BindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl.DeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &target);
+    glDeleteTextures(1, &depthTexture);
+    return ok;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SDL3/SDL_opengl.h>
+
+#include "DepthColor.h"
+
+// Colorizes raw 16 bit depth in a fragment shader, with the same colormaps as depthToBgra().
+// The depth is uploaded as a single channel GL_R16UI texture, half the size of the BGRA copy,
+// and the CPU never touches the pixels. Needs GL 3.0 / GLSL 1.30 and a current context.
+
+bool initDepthShader();
+void destroyDepthShader();
+
+// Texture the raw depth is uploaded to, created for w x h frames
+GLuint createDepthTexture(int w, int h);
+void uploadDepthTexture(GLuint texture, const uint16_t* pixels, int w, int h);
+
+// Bind the depth texture, then draw textured geometry between begin and end
+void beginDepthShader(const DepthColorSettings& settings);
+void endDepthShader();
+
+// Renders a test pattern offscreen in every colormap and compares it with depthToBgra(),
+// so the shader can be checked on Mesa's software rasterizer. Returns false on a mismatch.
+bool checkDepthShader();
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Frames.h"
+
+// Same values as NUI_IMAGE_RESOLUTION, RESOLUTION_OFF leaves the stream closed
+enum Resolution {
+    RESOLUTION_OFF = -1,
+    RESOLUTION_80x60 = 0,
+    RESOLUTION_320x240,
+    RESOLUTION_640x480,
+    RESOLUTION_1280x960
+};
+
+inline int resolutionWidth(Resolution r) {
+    static const int widths[] = { 80, 320, 640, 1280 };
+    return r == RESOLUTION_OFF ? 0 : widths[r];
+}
+
+inline int resolutionHeight(Resolution r) {
+    return resolutionWidth(r) * 3 / 4;
+}
+
+// Image streams a source should produce. The sensor does depth up to 640x480 and color at
+// 640x480 (30 fps) or 1280x960 (12 fps). Skeletons are always tracked.
+struct StreamSettings {
+    Resolution depth = RESOLUTION_640x480;
+    Resolution color = RESOLUTION_640x480;
+
+    int mask() const {
+        return STREAM_SKELETON | (depth != RESOLUTION_OFF ? STREAM_DEPTH : 0) | (color != RESOLUTION_OFF ? STREAM_COLOR : 0);
+    }
+};
+
+// Anything that can produce depth, color and skeleton frames for the capture thread.
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    // Block until at least one stream has a frame ready or timeoutMs passes.
+    // Returns the STREAM_* bits of the streams that are ready, 0 on timeout.
+    virtual int waitForFrames(int timeoutMs) = 0;
+
+    // Fill the frame with the next one from the stream, false if there was none
+    virtual bool readDepth(DepthFrame& frame) = 0;
+    virtual bool readColor(ColorFrame& frame) = 0;
+    virtual bool readSkeleton(SkeletonFrame& frame) = 0;
+
+    // Drop the waiting frames of the STREAM_* bits without reading them
+    virtual void skipFrames(int streams) = 0;
+};
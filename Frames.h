@@ -0,0 +1,160 @@
+#pragma once
+
+// Sensor frame types shared by the frame sources, the capture thread and the main loop.
+// The layout follows the NUI structures so the Kinect source can fill them directly,
+// but nothing in here depends on the Kinect SDK.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include <glm/glm.hpp>
+
+#define SKELETON_COUNT 6
+#define JOINT_COUNT 20
+
+// Same order as NUI_SKELETON_POSITION_INDEX
+enum JointIndex {
+    JOINT_HIP_CENTER = 0,
+    JOINT_SPINE,
+    JOINT_SHOULDER_CENTER,
+    JOINT_HEAD,
+    JOINT_SHOULDER_LEFT,
+    JOINT_ELBOW_LEFT,
+    JOINT_WRIST_LEFT,
+    JOINT_HAND_LEFT,
+    JOINT_SHOULDER_RIGHT,
+    JOINT_ELBOW_RIGHT,
+    JOINT_WRIST_RIGHT,
+    JOINT_HAND_RIGHT,
+    JOINT_HIP_LEFT,
+    JOINT_KNEE_LEFT,
+    JOINT_ANKLE_LEFT,
+    JOINT_FOOT_LEFT,
+    JOINT_HIP_RIGHT,
+    JOINT_KNEE_RIGHT,
+    JOINT_ANKLE_RIGHT,
+    JOINT_FOOT_RIGHT
+};
+
+// Same values as NUI_SKELETON_POSITION_TRACKING_STATE
+enum JointState {
+    JOINT_NOT_TRACKED = 0,
+    JOINT_INFERRED,
+    JOINT_TRACKED
+};
+
+// Bits returned by FrameSource::waitForFrames()
+enum StreamMask {
+    STREAM_DEPTH = 1,
+    STREAM_COLOR = 2,
+    STREAM_SKELETON = 4
+};
+
+inline void* allocAligned(size_t bytes) {
+#ifdef _WIN32
+    return _aligned_malloc(bytes, 64);
+#else
+    void* p = NULL;
+    return posix_memalign(&p, 64, bytes) == 0 ? p : NULL;
+#endif
+}
+
+inline void freeAligned(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+// Frame pixel storage, 64 byte aligned for the SIMD kernels and texture uploads.
+// Each triple buffer slot allocates once and keeps its memory, it is only reallocated
+// (without keeping the old contents) when a bigger frame comes in.
+// It can also point at pixels owned by someone else, like a mapped recording.
+template <typename T>
+class PixelBuffer {
+public:
+    PixelBuffer() : pixels(NULL), view(NULL), count(0), capacity(0) {}
+    PixelBuffer(const PixelBuffer& other) : pixels(NULL), view(NULL), count(0), capacity(0) { *this = other; }
+    ~PixelBuffer() { freeAligned(pixels); }
+
+    PixelBuffer& operator=(const PixelBuffer& other) {
+        if (this != &other) {
+            resize(other.count);
+            if (count) memcpy(pixels, other.data(), count * sizeof(T));
+        }
+        return *this;
+    }
+
+    void resize(size_t n) {
+        view = NULL;
+        if (n > capacity) {
+            freeAligned(pixels);
+            pixels = (T*)allocAligned(n * sizeof(T));
+            capacity = n;
+        }
+        count = n;
+    }
+
+    // Use n elements at external without copying them. They have to stay valid until
+    // the next wrap() or resize(), which goes back to the buffer's own memory.
+    void wrap(T* external, size_t n) {
+        view = external;
+        count = n;
+    }
+
+    T* data() { return view ? view : pixels; }
+    const T* data() const { return view ? view : pixels; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) { return data()[i]; }
+    const T& operator[](size_t i) const { return data()[i]; }
+
+private:
+    T* pixels;
+    T* view;
+    size_t count;
+    size_t capacity;
+};
+
+struct DepthFrame {
+    int sensor = 0;                 // Index of the sensor that captured it
+    uint64_t sequence = 0;          // Counts up per captured frame, so consumers can skip ones they've seen
+    int64_t timestamp = 0;          // Sensor time in milliseconds
+    int64_t captureMicros = 0;      // steadyMicros() when the capture thread read it
+    uint32_t frameNumber = 0;
+    int width = 0;
+    int height = 0;
+    PixelBuffer<uint16_t> pixels;   // Packed NUI depth pixels: (millimeters << 3) | player index
+};
+
+struct ColorFrame {
+    int sensor = 0;
+    uint64_t sequence = 0;
+    int64_t timestamp = 0;
+    int64_t captureMicros = 0;
+    uint32_t frameNumber = 0;
+    int width = 0;
+    int height = 0;
+    PixelBuffer<uint8_t> pixels;    // BGRA, 4 bytes per pixel
+};
+
+struct SkeletonBody {
+    bool tracked = false;
+    int sensor = 0;
+    uint32_t trackingId = 0;
+    glm::vec4 joints[JOINT_COUNT];
+    uint8_t jointStates[JOINT_COUNT] = { 0 };
+};
+
+struct SkeletonFrame {
+    int sensor = 0;
+    uint64_t sequence = 0;
+    int64_t timestamp = 0;
+    int64_t captureMicros = 0;
+    uint32_t frameNumber = 0;
+    SkeletonBody bodies[SKELETON_COUNT];
+};
@@ -0,0 +1,92 @@
+#include "Geometry.h"
+
+#include <string.h>
+
+void FrameGeometry::clear() {
+    objectCount = strokeCount = vertexCount = 0;
+    grid = 0;
+    objectOpen = strokeOpen = false;
+    objects[0].firstStroke = 0;
+    strokeStart[0] = 0;
+}
+
+bool FrameGeometry::beginObject(int label) {
+    strokeOpen = false;
+    objectOpen = objectCount < MAX_GEOMETRY_OBJECTS;
+    if (!objectOpen) return false;
+    objects[objectCount].label = label;
+    objects[objectCount].firstStroke = strokeCount;
+    objectCount++;
+    objects[objectCount].firstStroke = strokeCount;
+    return true;
+}
+
+bool FrameGeometry::beginStroke() {
+    strokeOpen = objectOpen && strokeCount < MAX_GEOMETRY_STROKES;
+    if (!strokeOpen) return false;
+    strokeCount++;
+    strokeStart[strokeCount] = vertexCount;
+    objects[objectCount].firstStroke = strokeCount;
+    return true;
+}
+
+bool FrameGeometry::addVertex(float x, float y, float z) {
+    if (!strokeOpen || vertexCount == MAX_GEOMETRY_VERTICES) return false;
+    this->x[vertexCount] = x;
+    this->y[vertexCount] = y;
+    this->z[vertexCount] = z;
+    vertexCount++;
+    strokeStart[strokeCount] = vertexCount;
+    return true;
+}
+
+// One component of every vertex, rounding half away from zero
+static void quantize(float* v, int32_t* q, int n, float grid, float steps) {
+    for (int i = 0; i < n; i++) {
+        float k = v[i] * steps;
+        q[i] = (int32_t)(k + (k < 0 ? -0.5f : 0.5f));
+        v[i] = q[i] * grid;
+    }
+}
+
+void quantizeGeometry(FrameGeometry& geometry, float grid) {
+    geometry.grid = grid > 0 ? grid : 0;
+    if (geometry.grid == 0) return;
+    float steps = 1 / grid;
+    quantize(geometry.x, geometry.qx, geometry.vertexCount, grid, steps);
+    quantize(geometry.y, geometry.qy, geometry.vertexCount, grid, steps);
+    quantize(geometry.z, geometry.qz, geometry.vertexCount, grid, steps);
+}
+
+bool sameGeometry(const FrameGeometry& a, const FrameGeometry& b) {
+    if (a.objectCount != b.objectCount || a.strokeCount != b.strokeCount || a.vertexCount != b.vertexCount) return false;
+    if (memcmp(a.objects, b.objects, (a.objectCount + 1) * sizeof(GeometryObject)) ||
+        memcmp(a.strokeStart, b.strokeStart, (a.strokeCount + 1) * sizeof(int))) return false;
+    if (a.grid > 0 && a.grid == b.grid) {
+        return !memcmp(a.qx, b.qx, a.vertexCount * sizeof(int32_t)) &&
+            !memcmp(a.qy, b.qy, a.vertexCount * sizeof(int32_t)) &&
+            !memcmp(a.qz, b.qz, a.vertexCount * sizeof(int32_t));
+    }
+    return !memcmp(a.x, b.x, a.vertexCount * sizeof(float)) &&
+        !memcmp(a.y, b.y, a.vertexCount * sizeof(float)) &&
+        !memcmp(a.z, b.z, a.vertexCount * sizeof(float));
+}
+
+void copyGeometry(FrameGeometry& to, const FrameGeometry& from) {
+    to.timestamp = from.timestamp;
+    to.frameNumber = from.frameNumber;
+    to.latencyMs = from.latencyMs;
+    to.objectCount = from.objectCount;
+    to.strokeCount = from.strokeCount;
+    to.vertexCount = from.vertexCount;
+    to.grid = from.grid;
+    memcpy(to.objects, from.objects, (from.objectCount + 1) * sizeof(GeometryObject));
+    memcpy(to.strokeStart, from.strokeStart, (from.strokeCount + 1) * sizeof(int));
+    memcpy(to.x, from.x, from.vertexCount * sizeof(float));
+    memcpy(to.y, from.y, from.vertexCount * sizeof(float));
+    memcpy(to.z, from.z, from.vertexCount * sizeof(float));
+    if (from.grid == 0) return;
+    memcpy(to.qx, from.qx, from.vertexCount * sizeof(int32_t));
+    memcpy(to.qy, from.qy, from.vertexCount * sizeof(int32_t));
+    memcpy(to.qz, from.qz, from.vertexCount * sizeof(int32_t));
+}
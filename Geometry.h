@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Frames.h"
+
+// One frame of output geometry: objects made of strokes, strokes made of runs of one flat vertex
+// array. Fixed capacity and cleared every frame, so building it never allocates. Everything that
+// draws writes into it, and turning it into what the receiver reads is the last step.
+
+#define MAX_GEOMETRY_OBJECTS SKELETON_COUNT
+#define MAX_GEOMETRY_STROKES (SKELETON_COUNT * 64)
+#define MAX_GEOMETRY_VERTICES (SKELETON_COUNT * 1024)
+
+struct GeometryObject {
+    int label;              // Body label, the object is "Skeleton <label>"
+    int firstStroke;        // Its strokes run up to the next object's firstStroke
+};
+
+struct FrameGeometry {
+    // The skeleton frame it was built from
+    int64_t timestamp = 0;
+    uint32_t frameNumber = 0;
+    float latencyMs = 0;
+
+    int objectCount = 0;
+    int strokeCount = 0;
+    int vertexCount = 0;
+    GeometryObject objects[MAX_GEOMETRY_OBJECTS + 1];   // objects[objectCount].firstStroke is strokeCount
+    int strokeStart[MAX_GEOMETRY_STROKES + 1];          // Stroke s is vertices [strokeStart[s], strokeStart[s + 1])
+    alignas(64) float x[MAX_GEOMETRY_VERTICES];
+    alignas(64) float y[MAX_GEOMETRY_VERTICES];
+    alignas(64) float z[MAX_GEOMETRY_VERTICES];
+    // With a grid, the vertices are on it and these are them in grid steps
+    float grid = 0;
+    alignas(64) int32_t qx[MAX_GEOMETRY_VERTICES];
+    alignas(64) int32_t qy[MAX_GEOMETRY_VERTICES];
+    alignas(64) int32_t qz[MAX_GEOMETRY_VERTICES];
+
+    FrameGeometry() { clear(); }
+    void clear();
+
+    // Strokes go to the last object begun, vertices to the last stroke.
+    // Each returns false and adds nothing once the frame is full, and once an object or stroke
+    // fails to begin nothing more goes in until the next one does, rather than joining the rest
+    // of it onto the one before.
+    bool beginObject(int label);
+    bool beginStroke();
+    bool addVertex(float x, float y, float z);
+
+private:
+    bool objectOpen;
+    bool strokeOpen;
+};
+
+// Snaps every vertex to the nearest point of a grid this many meters apart and keeps the grid
+// steps, or with grid 0 leaves the vertices as they are. Sensor noise far below the grid then
+// stops changing the frame, and the serializers can print the steps in fixed point.
+void quantizeGeometry(FrameGeometry& geometry, float grid);
+
+// The same objects, strokes and vertices, what the frame was built from aside. Two frames on
+// the same grid compare their steps.
+bool sameGeometry(const FrameGeometry& a, const FrameGeometry& b);
+
+// Copies only what the frame uses, rather than every array to capacity
+void copyGeometry(FrameGeometry& to, const FrameGeometry& from);
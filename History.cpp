@@ -0,0 +1,80 @@
+#include "History.h"
+
+#include <string.h>
+
+JointHistory::JointHistory() : bodies(0), newest(0), pushed(0) {
+    memset(sensorTime, 0, sizeof(sensorTime));
+    memset(capture, 0, sizeof(capture));
+}
+
+void JointHistory::push(const BodyStore& store) {
+    float (*state[3 * HISTORY_LENGTH])[JOINT_COUNT];
+    for (int k = 0; k < HISTORY_LENGTH; k++) {
+        state[3 * k] = px[k];
+        state[3 * k + 1] = py[k];
+        state[3 * k + 2] = pz[k];
+    }
+    followBodies(store, bodies, seen, state, 3 * HISTORY_LENGTH);
+    bodies = store.count;
+
+    newest = (newest + 1) & (HISTORY_LENGTH - 1);
+    sensorTime[newest] = store.timestamp;
+    capture[newest] = store.captureMicros;
+    if (pushed < HISTORY_LENGTH) pushed++;
+    for (int b = 0; b < store.count; b++) {
+        memcpy(px[newest][b], store.x[b], sizeof(px[newest][b]));
+        memcpy(py[newest][b], store.y[b], sizeof(py[newest][b]));
+        memcpy(pz[newest][b], store.z[b], sizeof(pz[newest][b]));
+        if (seen[b] == 0) {
+            for (int k = 0; k < HISTORY_LENGTH; k++) {
+                if (k == newest) continue;
+                memcpy(px[k][b], store.x[b], sizeof(px[k][b]));
+                memcpy(py[k][b], store.y[b], sizeof(py[k][b]));
+                memcpy(pz[k][b], store.z[b], sizeof(pz[k][b]));
+            }
+        }
+        if (seen[b] < HISTORY_LENGTH) seen[b]++;
+    }
+}
+
+float JointHistory::step(int age) const {
+    // A long gap, like a seek or a restart, isn't a time step to difference over
+    float dt = (sensorTime[slot(age)] - sensorTime[slot(age + 1)]) / 1000.0f;
+    return dt > 0 && dt < 0.5f ? dt : 1.0f / 30;
+}
+
+// One joint component of every active body at once
+static void firstDifference(const float* p0, const float* p1, float scale, float* out, int n) {
+    for (int i = 0; i < n; i++) out[i] = (p0[i] - p1[i]) * scale;
+}
+
+static void secondDifference(const float* p0, const float* p1, const float* p2, float s0, float s1, float* out, int n) {
+    for (int i = 0; i < n; i++) out[i] = (p0[i] - p1[i]) * s0 - (p1[i] - p2[i]) * s1;
+}
+
+void JointHistory::velocity(float (*vx)[JOINT_COUNT], float (*vy)[JOINT_COUNT], float (*vz)[JOINT_COUNT]) const {
+    // New bodies repeat their first pose, so they come out at 0 without a check
+    int n = bodies * JOINT_COUNT;
+    float scale = 1 / step(0);
+    firstDifference(px[slot(0)][0], px[slot(1)][0], scale, vx[0], n);
+    firstDifference(py[slot(0)][0], py[slot(1)][0], scale, vy[0], n);
+    firstDifference(pz[slot(0)][0], pz[slot(1)][0], scale, vz[0], n);
+}
+
+void JointHistory::acceleration(float (*ax)[JOINT_COUNT], float (*ay)[JOINT_COUNT], float (*az)[JOINT_COUNT]) const {
+    // The change between the last two velocities, (p0 - p1) / dt0 - (p1 - p2) / dt1, over dt0
+    int n = bodies * JOINT_COUNT;
+    float dt0 = step(0), dt1 = step(1);
+    float s0 = 1 / (dt0 * dt0);
+    float s1 = 1 / (dt1 * dt0);
+    secondDifference(px[slot(0)][0], px[slot(1)][0], px[slot(2)][0], s0, s1, ax[0], n);
+    secondDifference(py[slot(0)][0], py[slot(1)][0], py[slot(2)][0], s0, s1, ay[0], n);
+    secondDifference(pz[slot(0)][0], pz[slot(1)][0], pz[slot(2)][0], s0, s1, az[0], n);
+    // A body's second pose has a velocity but the one before it was made up
+    for (int b = 0; b < bodies; b++) {
+        if (seen[b] >= 3) continue;
+        memset(ax[b], 0, sizeof(ax[b]));
+        memset(ay[b], 0, sizeof(ay[b]));
+        memset(az[b], 0, sizeof(az[b]));
+    }
+}
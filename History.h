@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Frames.h"
+#include "Skeletons.h"
+
+// The last HISTORY_LENGTH filtered poses of every body in one store, for everything that looks
+// back in time: prediction, interpolation, trails, gestures. It follows the bodies as the store
+// compacts. Fixed size and one array per joint component, so pushing and the queries never
+// allocate and loop over every joint of every body at once.
+
+#define HISTORY_LENGTH 8    // A power of 2
+
+class JointHistory {
+public:
+    JointHistory();
+
+    // Takes the store's newest positions and the times it carries in place of the oldest pose.
+    // Call after every store update and filter pass. A body new to the store fills its whole
+    // history with its first pose, so it stands still until it moves.
+    void push(const BodyStore& store);
+    void reset() { bodies = 0; pushed = 0; }
+
+    // Active bodies as of the newest pose, the poses pushed so far up to HISTORY_LENGTH,
+    // and how many of them a body has been in
+    int count() const { return bodies; }
+    int length() const { return pushed; }
+    int frames(int body) const { return seen[body]; }
+
+    // age 0 is the newest pose, up to length() - 1
+    int64_t captureMicros(int age) const { return capture[slot(age)]; }
+    // Seconds of sensor time from pose age + 1 to pose age, a frame at 30 Hz over gaps and restarts
+    float step(int age) const;
+    // Every active body's joints, [body][joint]
+    const float (*x(int age) const)[JOINT_COUNT] { return px[slot(age)]; }
+    const float (*y(int age) const)[JOINT_COUNT] { return py[slot(age)]; }
+    const float (*z(int age) const)[JOINT_COUNT] { return pz[slot(age)]; }
+
+    // Backward differences over the newest poses, in meters per second and per second squared.
+    // Bodies seen in too few poses get 0.
+    void velocity(float (*vx)[JOINT_COUNT], float (*vy)[JOINT_COUNT], float (*vz)[JOINT_COUNT]) const;
+    void acceleration(float (*ax)[JOINT_COUNT], float (*ay)[JOINT_COUNT], float (*az)[JOINT_COUNT]) const;
+
+private:
+    int slot(int age) const { return (newest - age) & (HISTORY_LENGTH - 1); }
+
+    int bodies;
+    int newest;
+    int pushed;
+    int seen[SKELETON_COUNT];
+    int64_t sensorTime[HISTORY_LENGTH];     // Milliseconds
+    int64_t capture[HISTORY_LENGTH];
+    alignas(64) float px[HISTORY_LENGTH][SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float py[HISTORY_LENGTH][SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float pz[HISTORY_LENGTH][SKELETON_COUNT][JOINT_COUNT];
+};
@@ -0,0 +1,50 @@
+#include "Interpolation.h"
+
+int64_t interpolateJoints(const JointHistory& history, const BodyStore& store, int64_t micros, InterpolationMode mode, BodyStore& out) {
+    out = store;
+    int64_t newest = history.captureMicros(0);
+    int64_t last = history.captureMicros(1);
+    int64_t interval = newest - last;
+    if (mode == INTERPOLATE_NONE || history.length() < 2 || history.count() != store.count || interval <= 0) return newest;
+
+    // Between the two newest frames, holding the newest when the next one is late
+    int64_t at = micros - interval;
+    float t = (float)(at - last) / interval;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+
+    // The active bodies are contiguous within each pose, so every joint goes in one loop
+    int n = store.count * JOINT_COUNT;
+    const float* x1 = history.x(1)[0];
+    const float* y1 = history.y(1)[0];
+    const float* z1 = history.z(1)[0];
+    const float* x2 = history.x(0)[0];
+    const float* y2 = history.y(0)[0];
+    const float* z2 = history.z(0)[0];
+    float* ox = out.x[0];
+    float* oy = out.y[0];
+    float* oz = out.z[0];
+    if (mode == INTERPOLATE_LINEAR || history.length() < 3) {
+        for (int i = 0; i < n; i++) {
+            ox[i] = x1[i] + (x2[i] - x1[i]) * t;
+            oy[i] = y1[i] + (y2[i] - y1[i]) * t;
+            oz[i] = z1[i] + (z2[i] - z1[i]) * t;
+        }
+    }
+    else {
+        // Hermite from p1 to p2, Catmull-Rom tangent (p2 - p0) / 2 at p1 and p2 - p1 at p2
+        const float* x0 = history.x(2)[0];
+        const float* y0 = history.y(2)[0];
+        const float* z0 = history.z(2)[0];
+        float t2 = t * t, t3 = t2 * t;
+        float h00 = 2 * t3 - 3 * t2 + 1;
+        float h10 = (t3 - 2 * t2 + t) * 0.5f;
+        float h01 = -2 * t3 + 3 * t2;
+        float h11 = t3 - t2;
+        for (int i = 0; i < n; i++) {
+            ox[i] = h00 * x1[i] + h10 * (x2[i] - x0[i]) + h01 * x2[i] + h11 * (x2[i] - x1[i]);
+            oy[i] = h00 * y1[i] + h10 * (y2[i] - y0[i]) + h01 * y2[i] + h11 * (y2[i] - y1[i]);
+            oz[i] = h00 * z1[i] + h10 * (z2[i] - z0[i]) + h01 * z2[i] + h11 * (z2[i] - z1[i]);
+        }
+    }
+    return last + (int64_t)(t * interval);
+}
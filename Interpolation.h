@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Frames.h"
+#include "History.h"
+#include "Skeletons.h"
+
+// Resamples the 30 Hz bodies at any output rate. The output runs one skeleton interval behind
+// the newest frame, so there are always two frames to interpolate between.
+
+enum InterpolationMode {
+    INTERPOLATE_NONE = 0,       // Every output gets the newest frame
+    INTERPOLATE_LINEAR,
+    INTERPOLATE_CATMULL_ROM     // Cubic through the last three frames, the newest tangent taken one sided
+};
+
+// The store's bodies as they were one skeleton interval before micros, from its history, into out.
+// Returns the capture time that corresponds to, for the latency it adds.
+// Constant time and no allocation, one pass over every joint of every body.
+int64_t interpolateJoints(const JointHistory& history, const BodyStore& store, int64_t micros, InterpolationMode mode, BodyStore& out);
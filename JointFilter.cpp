@@ -0,0 +1,239 @@
+#include "JointFilter.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+static const float twoPi = 6.28318531f;
+
+JointFilterSettings::JointFilterSettings() {
+    // Hands and feet move fastest, they get the higher cutoffs
+    setOneEuro(*this, -1, 1.0f, 1.0f, 1.0f);
+    const int extremities[] = { JOINT_WRIST_LEFT, JOINT_HAND_LEFT, JOINT_WRIST_RIGHT, JOINT_HAND_RIGHT,
+        JOINT_ANKLE_LEFT, JOINT_FOOT_LEFT, JOINT_ANKLE_RIGHT, JOINT_FOOT_RIGHT };
+    for (int joint : extremities) setOneEuro(*this, joint, 1.5f, 2.0f, 1.0f);
+    setDoubleExponential(*this, -1, 0.5f, 0.5f, 0.5f, 0.05f, 0.04f);
+}
+
+void setOneEuro(JointFilterSettings& settings, int joint, float minCutoff, float beta, float derivativeCutoff) {
+    for (int i = joint < 0 ? 0 : joint; i < (joint < 0 ? JOINT_COUNT : joint + 1); i++) {
+        settings.minCutoff[i] = minCutoff;
+        settings.beta[i] = beta;
+        settings.derivativeCutoff[i] = derivativeCutoff;
+    }
+}
+
+void setDoubleExponential(JointFilterSettings& settings, int joint, float smoothing, float correction, float prediction, float jitterRadius, float maxDeviationRadius) {
+    for (int i = joint < 0 ? 0 : joint; i < (joint < 0 ? JOINT_COUNT : joint + 1); i++) {
+        settings.smoothing[i] = smoothing;
+        settings.correction[i] = correction;
+        settings.prediction[i] = prediction;
+        // Both divide, keep them off zero
+        settings.jitterRadius[i] = jitterRadius > 1e-4f ? jitterRadius : 1e-4f;
+        settings.maxDeviationRadius[i] = maxDeviationRadius > 1e-4f ? maxDeviationRadius : 1e-4f;
+    }
+}
+
+// The per joint loops have no branches so the compiler can run them across the SIMD lanes
+
+static void oneEuro(float* x, float* y, float* z, float* fx, float* fy, float* fz, float* dx, float* dy, float* dz,
+    const JointFilterSettings& s, float dt) {
+    for (int i = 0; i < JOINT_COUNT; i++) {
+        float r = twoPi * s.derivativeCutoff[i] * dt;
+        float a = r / (r + 1);
+        dx[i] += ((x[i] - fx[i]) / dt - dx[i]) * a;
+        dy[i] += ((y[i] - fy[i]) / dt - dy[i]) * a;
+        dz[i] += ((z[i] - fz[i]) / dt - dz[i]) * a;
+        float speed = sqrtf(dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i]);
+
+        r = twoPi * (s.minCutoff[i] + s.beta[i] * speed) * dt;
+        a = r / (r + 1);
+        fx[i] += (x[i] - fx[i]) * a;
+        fy[i] += (y[i] - fy[i]) * a;
+        fz[i] += (z[i] - fz[i]) * a;
+        x[i] = fx[i];
+        y[i] = fy[i];
+        z[i] = fz[i];
+    }
+}
+
+static void doubleExponential(float* x, float* y, float* z, float* fx, float* fy, float* fz, float* tx, float* ty, float* tz,
+    const JointFilterSettings& s) {
+    for (int i = 0; i < JOINT_COUNT; i++) {
+        // Within the jitter radius the raw position is pulled towards the last filtered one
+        float ex = x[i] - fx[i], ey = y[i] - fy[i], ez = z[i] - fz[i];
+        float len = sqrtf(ex * ex + ey * ey + ez * ez);
+        float k = len < s.jitterRadius[i] ? len / s.jitterRadius[i] : 1.0f;
+        float rx = fx[i] + ex * k, ry = fy[i] + ey * k, rz = fz[i] + ez * k;
+
+        float sm = s.smoothing[i], c = s.correction[i];
+        float sx = rx * (1 - sm) + (fx[i] + tx[i]) * sm;
+        float sy = ry * (1 - sm) + (fy[i] + ty[i]) * sm;
+        float sz = rz * (1 - sm) + (fz[i] + tz[i]) * sm;
+        tx[i] = (sx - fx[i]) * c + tx[i] * (1 - c);
+        ty[i] = (sy - fy[i]) * c + ty[i] * (1 - c);
+        tz[i] = (sz - fz[i]) * c + tz[i] * (1 - c);
+        fx[i] = sx;
+        fy[i] = sy;
+        fz[i] = sz;
+
+        // Predict along the trend, but no further than the max deviation from the raw position
+        float px = sx + tx[i] * s.prediction[i] - x[i];
+        float py = sy + ty[i] * s.prediction[i] - y[i];
+        float pz = sz + tz[i] * s.prediction[i] - z[i];
+        len = sqrtf(px * px + py * py + pz * pz);
+        k = len > s.maxDeviationRadius[i] ? s.maxDeviationRadius[i] / len : 1.0f;
+        x[i] += px * k;
+        y[i] += py * k;
+        z[i] += pz * k;
+    }
+}
+
+JointFilter::JointFilter() : count(0), type(FILTER_NONE) {
+}
+
+void JointFilter::apply(BodyStore& store, const JointFilterSettings& settings, float dt) {
+    // Changing filters starts every body over
+    if (settings.type != type) {
+        type = settings.type;
+        count = 0;
+    }
+    float (*const state[])[JOINT_COUNT] = { fx, fy, fz, dx, dy, dz, untracked };
+    followBodies(store, count, frames, state, 7);
+    count = store.count;
+    if (type == FILTER_NONE) return;
+    if (dt <= 0) dt = 1.0f / 30;
+
+    for (int b = 0; b < store.count; b++) {
+        if (frames[b] == 0) {
+            memcpy(fx[b], store.x[b], sizeof(fx[b]));
+            memcpy(fy[b], store.y[b], sizeof(fy[b]));
+            memcpy(fz[b], store.z[b], sizeof(fz[b]));
+            memset(dx[b], 0, sizeof(dx[b]));
+            memset(dy[b], 0, sizeof(dy[b]));
+            memset(dz[b], 0, sizeof(dz[b]));
+            for (int i = 0; i < JOINT_COUNT; i++) untracked[b][i] = store.state[b][i] == JOINT_NOT_TRACKED;
+            frames[b] = 1;
+            continue;
+        }
+        // A joint the runtime lost reports the origin. It passes through raw, and starts over
+        // from its raw position when found again, rather than pulling the state towards 0,0,0.
+        for (int i = 0; i < JOINT_COUNT; i++) {
+            bool lost = store.state[b][i] == JOINT_NOT_TRACKED;
+            if (lost || untracked[b][i]) {
+                fx[b][i] = store.x[b][i];
+                fy[b][i] = store.y[b][i];
+                fz[b][i] = store.z[b][i];
+                dx[b][i] = dy[b][i] = dz[b][i] = 0;
+            }
+            untracked[b][i] = lost;
+        }
+        if (type == FILTER_ONE_EURO) oneEuro(store.x[b], store.y[b], store.z[b], fx[b], fy[b], fz[b], dx[b], dy[b], dz[b], settings, dt);
+        else doubleExponential(store.x[b], store.y[b], store.z[b], fx[b], fy[b], fz[b], dx[b], dy[b], dz[b], settings);
+    }
+}
+
+void filterTrack(const std::vector<SkeletonFrame>& frames, const JointFilterSettings& settings, BodyTrack& track) {
+    static BodyStore store;
+    store = BodyStore();
+    JointFilter filter;
+    track.reset((int)frames.size());
+    for (size_t f = 0; f < frames.size(); f++) {
+        float dt = f > 0 ? (frames[f].timestamp - frames[f - 1].timestamp) / 1000.0f : 0;
+        updateBodies(store, frames[f]);
+        filter.apply(store, settings, dt);
+        track.record((int)f, store);
+    }
+}
+
+bool benchJointFilters(FrameSource* source, int frames, float noiseMm, const JointFilterSettings& current) {
+    std::vector<SkeletonFrame> recorded;
+    readSkeletonFrames(source, frames, recorded);
+    int n = (int)recorded.size();
+    if (n < 8) {
+        printf("Not enough skeleton frames to filter\n");
+        return false;
+    }
+
+    addJointNoise(recorded, noiseMm);
+    float dt = (recorded[n - 1].timestamp - recorded[0].timestamp) / 1000.0f / (n - 1);
+    if (dt <= 0) dt = 1.0f / 30;
+
+    // The reference is the raw track averaged over 5 frames centered on each one, smooth and without lag
+    JointFilterSettings none;
+    none.type = FILTER_NONE;
+    BodyTrack raw, reference;
+    filterTrack(recorded, none, raw);
+    reference.reset(n);
+    for (int f = 2; f < n - 2; f++) {
+        for (int l = 0; l < SKELETON_COUNT; l++) {
+            for (int i = 0; i < JOINT_COUNT; i++) {
+                if (!raw.continuous(f - 2, f + 2, l, i)) continue;
+                glm::vec3 sum(0);
+                for (int k = -2; k <= 2; k++) sum += raw.position[raw.index(f + k, l, i)];
+                reference.position[raw.index(f, l, i)] = sum / 5.0f;
+                reference.valid[raw.index(f, l, i)] = 1;
+            }
+        }
+    }
+
+    struct FilterCase {
+        const char* name;
+        JointFilterSettings settings;
+    };
+    std::vector<FilterCase> cases(10);
+    cases[0].name = "none";
+    cases[0].settings.type = FILTER_NONE;
+    cases[1].name = "current settings";
+    cases[1].settings = current;
+    cases[2].name = "double exp runtime defaults";
+    cases[3].name = "double exp 0.5 0.1 0.5 0.1 0.1";
+    setDoubleExponential(cases[3].settings, -1, 0.5f, 0.1f, 0.5f, 0.1f, 0.1f);
+    cases[4].name = "double exp 0.7 0.3 1.0 1.0 1.0";
+    setDoubleExponential(cases[4].settings, -1, 0.7f, 0.3f, 1.0f, 1.0f, 1.0f);
+    cases[5].name = "one euro per joint defaults";
+    cases[5].settings.type = FILTER_ONE_EURO;
+    const float euro[4][2] = { { 1.0f, 0.5f }, { 1.0f, 2.0f }, { 2.0f, 1.0f }, { 0.5f, 4.0f } };
+    static char names[4][48];
+    for (int k = 0; k < 4; k++) {
+        snprintf(names[k], sizeof(names[k]), "one euro %.1f Hz beta %.1f", euro[k][0], euro[k][1]);
+        cases[6 + k].name = names[k];
+        cases[6 + k].settings.type = FILTER_ONE_EURO;
+        setOneEuro(cases[6 + k].settings, -1, euro[k][0], euro[k][1], 1.0f);
+    }
+
+    printf("%d frames, %.1f ms apart, %.1f mm of added noise\n", n, dt * 1000, noiseMm);
+    printf("%-32s %12s %10s %12s\n", "filter", "jitter mm", "vs raw", "latency ms");
+    double rawJitter = 0;
+    BodyTrack filtered;
+    for (size_t c = 0; c < cases.size(); c++) {
+        filterTrack(recorded, cases[c].settings, filtered);
+        double jitter = 0, lagNum = 0, lagDen = 0;
+        int jitterCount = 0;
+        for (int f = 0; f < n; f++) {
+            for (int l = 0; l < SKELETON_COUNT; l++) {
+                for (int i = 0; i < JOINT_COUNT; i++) {
+                    size_t t = raw.index(f, l, i);
+                    if (filtered.continuous(f - 2, f, l, i)) {
+                        glm::vec3 a = filtered.position[t] - 2.0f * filtered.position[raw.index(f - 1, l, i)] + filtered.position[raw.index(f - 2, l, i)];
+                        jitter += glm::dot(a, a);
+                        jitterCount++;
+                    }
+                    // Lag is how far back along the reference's velocity the output sits
+                    if (f > 0 && f < n - 1 && filtered.valid[t] && reference.valid[raw.index(f - 1, l, i)]
+                        && reference.valid[t] && reference.valid[raw.index(f + 1, l, i)]) {
+                        glm::vec3 v = (reference.position[raw.index(f + 1, l, i)] - reference.position[raw.index(f - 1, l, i)]) / (2 * dt);
+                        lagNum += glm::dot(reference.position[t] - filtered.position[t], v);
+                        lagDen += glm::dot(v, v);
+                    }
+                }
+            }
+        }
+        jitter = jitterCount > 0 ? sqrt(jitter / jitterCount) * 1000 : 0;
+        if (cases[c].settings.type == FILTER_NONE) rawJitter = jitter;
+        double latency = lagDen > 0 ? lagNum / lagDen * 1000 : 0;
+        printf("%-32s %12.2f %9.0f%% %12.1f\n", cases[c].name, jitter, rawJitter > 0 ? jitter / rawJitter * 100 : 100, latency);
+    }
+    return true;
+}
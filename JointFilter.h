@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Frames.h"
+#include "FrameSource.h"
+#include "Skeletons.h"
+
+// Smooths the joint positions of the body store in place. It stands in for the runtime's
+// NuiTransformSmooth() so the lag against jitter trade can be tuned per joint. Joints the
+// runtime doesn't track pass through unfiltered, inferred joints are filtered like tracked ones.
+
+enum FilterType {
+    FILTER_NONE = 0,
+    FILTER_ONE_EURO,            // Low pass whose cutoff rises with speed, little lag on fast moves
+    FILTER_DOUBLE_EXPONENTIAL   // Holt smoothing with trend, after NuiTransformSmooth()
+};
+
+// Parameters for every joint, one array per parameter
+struct JointFilterSettings {
+    FilterType type = FILTER_DOUBLE_EXPONENTIAL;
+
+    // One-Euro
+    float minCutoff[JOINT_COUNT];           // Hz, cutoff while the joint stands still
+    float beta[JOINT_COUNT];                // Hz added per meter/second of speed
+    float derivativeCutoff[JOINT_COUNT];    // Hz, for the speed estimate
+
+    // Double exponential, as in NUI_TRANSFORM_SMOOTH_PARAMETERS
+    float smoothing[JOINT_COUNT];
+    float correction[JOINT_COUNT];
+    float prediction[JOINT_COUNT];
+    float jitterRadius[JOINT_COUNT];        // Meters
+    float maxDeviationRadius[JOINT_COUNT];  // Meters
+
+    // The double exponential starts out with the runtime's default parameters, which don't make it
+    // behave the same, the runtime also treats inferred joints differently
+    JointFilterSettings();
+};
+
+// joint < 0 sets every joint
+void setOneEuro(JointFilterSettings& settings, int joint, float minCutoff, float beta, float derivativeCutoff);
+void setDoubleExponential(JointFilterSettings& settings, int joint, float smoothing, float correction, float prediction, float jitterRadius, float maxDeviationRadius);
+
+// Filter state of the bodies in one store, it follows the bodies as the store compacts
+class JointFilter {
+public:
+    JointFilter();
+
+    // Filters every active body at once, dt is the seconds since the last frame.
+    // Bodies new to the store start out unfiltered.
+    void apply(BodyStore& store, const JointFilterSettings& settings, float dt);
+
+    void reset() { count = 0; }
+
+private:
+    int count;
+    FilterType type;
+    int frames[SKELETON_COUNT];
+    // Last filtered position, and the smoothed velocity (One-Euro) or trend (double exponential)
+    alignas(64) float fx[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float fy[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float fz[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float dx[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float dy[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float dz[SKELETON_COUNT][JOINT_COUNT];
+    // 1 where the joint wasn't tracked last frame, a float so it follows the bodies with the rest
+    alignas(64) float untracked[SKELETON_COUNT][JOINT_COUNT];
+};
+
+// Runs frames through a fresh body store and filter and records the filtered joints
+void filterTrack(const std::vector<SkeletonFrame>& frames, const JointFilterSettings& settings, BodyTrack& track);
+
+// Offline harness: reads up to frames skeleton frames from source, adds noiseMm of uniform noise
+// if asked to, and runs them through the current settings and a set of alternatives.
+// Reports each one's jitter, the RMS frame to frame acceleration of the tracked joints, against
+// its latency, the lag behind a zero phase smoothed reference. Returns false without frames.
+bool benchJointFilters(FrameSource* source, int frames, float noiseMm, const JointFilterSettings& current);
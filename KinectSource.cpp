@@ -0,0 +1,194 @@
+#include "KinectSource.h"
+
+#include <string.h>
+
+// Copies rows in one go when the pitch matches the row size, otherwise row by row
+static bool copyLockedRect(uint8_t* dest, const NUI_LOCKED_RECT& rect, int rowBytes, int rows) {
+    if (rect.Pitch < rowBytes || rect.size < rect.Pitch * (rows - 1) + rowBytes) return false;
+    const uint8_t* src = (const uint8_t*)rect.pBits;
+    if (rect.Pitch == rowBytes) memcpy(dest, src, rowBytes * rows);
+    else for (int y = 0; y < rows; y++) memcpy(dest + y * rowBytes, src + y * rect.Pitch, rowBytes);
+    return true;
+}
+
+KinectSource::KinectSource() :
+    sensor(NULL),
+    depthWidth(0),
+    depthHeight(0),
+    colorWidth(0),
+    colorHeight(0),
+    depthStream(NULL),
+    rgbStream(NULL),
+    nextDepthEvent(NULL),
+    nextColorEvent(NULL),
+    nextSkeletonEvent(NULL) {
+}
+
+KinectSource::~KinectSource() {
+    close();
+}
+
+int KinectSource::sensorCount() {
+    int numSensors = 0;
+    if (NuiGetSensorCount(&numSensors) < 0) return 0;
+    return numSensors;
+}
+
+bool KinectSource::open(int index, const StreamSettings& streams) {
+    // Get a working kinect sensor
+    int numSensors = 0;
+    if (NuiGetSensorCount(&numSensors) < 0 || numSensors <= index) return false;
+    if (NuiCreateSensorByIndex(index, &sensor) < 0) return false;
+
+    // Initialize sensor. Skeleton tracking runs on depth even when the depth stream isn't opened,
+    // but leaving color out stops the sensor from sending it at all.
+    DWORD flags = NUI_INITIALIZE_FLAG_USES_DEPTH | NUI_INITIALIZE_FLAG_USES_SKELETON;
+    if (streams.color != RESOLUTION_OFF) flags |= NUI_INITIALIZE_FLAG_USES_COLOR;
+    if (sensor->NuiInitialize(flags) < 0) {
+        sensor->Release();
+        sensor = NULL;
+        return false;
+    }
+
+    // Manual reset events, the runtime resets them when the frame is fetched
+    if (streams.depth != RESOLUTION_OFF) nextDepthEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (streams.color != RESOLUTION_OFF) nextColorEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    nextSkeletonEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    sensor->NuiSkeletonTrackingEnable(
+        nextSkeletonEvent,
+        0     // NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT for only upper body
+    );
+
+    if (streams.depth != RESOLUTION_OFF) {
+        sensor->NuiImageStreamOpen(
+            NUI_IMAGE_TYPE_DEPTH,
+            (NUI_IMAGE_RESOLUTION)streams.depth,    // Image resolution
+            0,      // Image stream flags, e.g. near mode
+            2,      // Number of frames to buffer
+            nextDepthEvent,
+            &depthStream);
+        depthWidth = resolutionWidth(streams.depth);
+        depthHeight = resolutionHeight(streams.depth);
+    }
+    if (streams.color != RESOLUTION_OFF) {
+        sensor->NuiImageStreamOpen(
+            NUI_IMAGE_TYPE_COLOR,                     // Depth camera or rgb camera?
+            (NUI_IMAGE_RESOLUTION)streams.color,      // Image resolution
+            0,      // Image stream flags, e.g. near mode
+            2,      // Number of frames to buffer
+            nextColorEvent,
+            &rgbStream);
+        colorWidth = resolutionWidth(streams.color);
+        colorHeight = resolutionHeight(streams.color);
+    }
+    return true;
+}
+
+void KinectSource::close() {
+    if (sensor) {
+        sensor->NuiShutdown();
+        sensor->Release();
+        sensor = NULL;
+    }
+    if (nextDepthEvent) CloseHandle(nextDepthEvent);
+    if (nextColorEvent) CloseHandle(nextColorEvent);
+    if (nextSkeletonEvent) CloseHandle(nextSkeletonEvent);
+    nextDepthEvent = nextColorEvent = nextSkeletonEvent = NULL;
+    depthStream = rgbStream = NULL;
+    depthWidth = depthHeight = colorWidth = colorHeight = 0;
+}
+
+int KinectSource::waitForFrames(int timeoutMs) {
+    // Only the streams that are open have events
+    HANDLE events[3] = { nextSkeletonEvent };
+    DWORD count = 1;
+    if (nextDepthEvent) events[count++] = nextDepthEvent;
+    if (nextColorEvent) events[count++] = nextColorEvent;
+    DWORD result = WaitForMultipleObjects(count, events, FALSE, timeoutMs);
+    if (result == WAIT_TIMEOUT || result == WAIT_FAILED) return 0;
+
+    // WaitForMultipleObjects only reports the first signaled event, poll the others
+    int ready = 0;
+    if (nextDepthEvent && WaitForSingleObject(nextDepthEvent, 0) == WAIT_OBJECT_0) ready |= STREAM_DEPTH;
+    if (nextColorEvent && WaitForSingleObject(nextColorEvent, 0) == WAIT_OBJECT_0) ready |= STREAM_COLOR;
+    if (WaitForSingleObject(nextSkeletonEvent, 0) == WAIT_OBJECT_0) ready |= STREAM_SKELETON;
+    return ready;
+}
+
+bool KinectSource::readDepth(DepthFrame& frame) {
+    NUI_IMAGE_FRAME imageFrame;
+    NUI_LOCKED_RECT LockedRect;
+    if (!depthStream || sensor->NuiImageStreamGetNextFrame(depthStream, 0, &imageFrame) < 0) return false;
+    INuiFrameTexture* texture = imageFrame.pFrameTexture;
+    texture->LockRect(0, &LockedRect, NULL, 0);
+
+    frame.pixels.resize(depthWidth * depthHeight);
+    bool ok = copyLockedRect((uint8_t*)frame.pixels.data(), LockedRect, depthWidth * sizeof(uint16_t), depthHeight);
+    if (ok) {
+        frame.timestamp = imageFrame.liTimeStamp.QuadPart;
+        frame.frameNumber = imageFrame.dwFrameNumber;
+        frame.width = depthWidth;
+        frame.height = depthHeight;
+    }
+
+    texture->UnlockRect(0);
+    sensor->NuiImageStreamReleaseFrame(depthStream, &imageFrame);
+    return ok;
+}
+
+bool KinectSource::readColor(ColorFrame& frame) {
+    NUI_IMAGE_FRAME imageFrame;
+    NUI_LOCKED_RECT LockedRect;
+    if (!rgbStream || sensor->NuiImageStreamGetNextFrame(rgbStream, 0, &imageFrame) < 0) return false;
+    INuiFrameTexture* texture = imageFrame.pFrameTexture;
+    texture->LockRect(0, &LockedRect, NULL, 0);
+
+    // One bulk copy into the pooled frame, the renderer uploads straight from it
+    frame.pixels.resize(colorWidth * colorHeight * 4);
+    bool ok = copyLockedRect(frame.pixels.data(), LockedRect, colorWidth * 4, colorHeight);
+    if (ok) {
+        frame.timestamp = imageFrame.liTimeStamp.QuadPart;
+        frame.frameNumber = imageFrame.dwFrameNumber;
+        frame.width = colorWidth;
+        frame.height = colorHeight;
+    }
+
+    texture->UnlockRect(0);
+    sensor->NuiImageStreamReleaseFrame(rgbStream, &imageFrame);
+    return ok;
+}
+
+// The frames still have to be fetched to reset their events, but they are released without being locked or copied
+void KinectSource::skipFrames(int streams) {
+    NUI_IMAGE_FRAME imageFrame;
+    if ((streams & STREAM_DEPTH) && depthStream && sensor->NuiImageStreamGetNextFrame(depthStream, 0, &imageFrame) >= 0)
+        sensor->NuiImageStreamReleaseFrame(depthStream, &imageFrame);
+    if ((streams & STREAM_COLOR) && rgbStream && sensor->NuiImageStreamGetNextFrame(rgbStream, 0, &imageFrame) >= 0)
+        sensor->NuiImageStreamReleaseFrame(rgbStream, &imageFrame);
+    if (streams & STREAM_SKELETON) {
+        NUI_SKELETON_FRAME sF;
+        sensor->NuiSkeletonGetNextFrame(0, &sF);
+    }
+}
+
+bool KinectSource::readSkeleton(SkeletonFrame& frame) {
+    NUI_SKELETON_FRAME sF = { 0 };
+    // Raw positions, the joint filter stage does the smoothing
+    if (sensor->NuiSkeletonGetNextFrame(0, &sF) < 0) return false;
+
+    frame.timestamp = sF.liTimeStamp.QuadPart;
+    frame.frameNumber = sF.dwFrameNumber;
+    for (int z = 0; z < SKELETON_COUNT; z++) {
+        const NUI_SKELETON_DATA& skeleton = sF.SkeletonData[z];
+        SkeletonBody& body = frame.bodies[z];
+        body.tracked = skeleton.eTrackingState == NUI_SKELETON_TRACKED;
+        body.trackingId = skeleton.dwTrackingID;
+        for (int i = 0; i < JOINT_COUNT; i++) {
+            const Vector4& p = skeleton.SkeletonPositions[i];
+            body.joints[i] = glm::vec4(p.x, p.y, p.z, p.w);
+            body.jointStates[i] = (uint8_t)skeleton.eSkeletonPositionTrackingState[i];
+        }
+    }
+    return true;
+}
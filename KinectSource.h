@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Windows.h>
+#include <Ole2.h>
+#include <NuiApi.h>
+
+#include "FrameSource.h"
+
+// Frame source backed by a Kinect v1 sensor through the NUI API.
+// Each stream signals its own next-frame event, so waitForFrames() sleeps until the sensor has data.
+class KinectSource : public FrameSource {
+public:
+    KinectSource();
+    ~KinectSource();
+
+    // Number of sensors attached, open() takes 0 to count - 1
+    static int sensorCount();
+
+    bool open(int index, const StreamSettings& streams);
+    void close();
+
+    int waitForFrames(int timeoutMs);
+    bool readDepth(DepthFrame& frame);
+    bool readColor(ColorFrame& frame);
+    bool readSkeleton(SkeletonFrame& frame);
+    void skipFrames(int streams);
+
+private:
+    INuiSensor* sensor;
+    int depthWidth, depthHeight;
+    int colorWidth, colorHeight;
+    HANDLE depthStream;
+    HANDLE rgbStream;
+    HANDLE nextDepthEvent;
+    HANDLE nextColorEvent;
+    HANDLE nextSkeletonEvent;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+// Thin layer over winsock so the osci-render connection also builds against BSD sockets.
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#define MSG_NOSIGNAL 0
+#else
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define WSAGetLastError() errno
+
+inline int closesocket(SOCKET s) {
+    return close(s);
+}
+#endif
+
+inline int netStartup() {
+#ifdef _WIN32
+    WSADATA wsaData = { 0 };
+    return WSAStartup(MAKEWORD(2, 2), &wsaData);
+#else
+    return 0;
+#endif
+}
+
+inline void netCleanup() {
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
@@ -0,0 +1,373 @@
+#include "OsciBinary.h"
+
+#include <string.h>
+
+// A whole object before its stroke lengths: strokeCount, vertexCount, matrix
+static const int wholeHeaderBytes = 8 + 16 * 4;
+
+template <typename T> static char* put(char* p, T value) {
+    memcpy(p, &value, sizeof(T));
+    return p + sizeof(T);
+}
+
+template <typename T> static const char* get(const char* p, T& value) {
+    memcpy(&value, p, sizeof(T));
+    return p + sizeof(T);
+}
+
+// Round to nearest even, overflow to infinity, underflow through the subnormals to zero
+static uint16_t toHalf(float value) {
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint32_t sign = (f >> 16) & 0x8000;
+    uint32_t exponent = (f >> 23) & 0xff;
+    uint32_t mantissa = f & 0x7fffff;
+    if (exponent == 0xff) return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    int e = (int)exponent - 127 + 15;
+    if (e >= 31) return (uint16_t)(sign | 0x7c00);
+    if (e <= 0) {
+        if (e < -10) return (uint16_t)sign;
+        mantissa |= 0x800000;
+        int shift = 14 - e;
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+    // Rounding up a full mantissa carries into the exponent, as it should
+    uint32_t half = ((uint32_t)e << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+    return (uint16_t)(sign | half);
+}
+
+static float fromHalf(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+    if (exponent == 0) {
+        float value = mantissa * (1.0f / 16777216);
+        return sign ? -value : value;
+    }
+    uint32_t f = exponent == 0x1f ? sign | 0x7f800000 | (mantissa << 13) : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float value;
+    memcpy(&value, &f, sizeof(value));
+    return value;
+}
+
+static size_t vertexBytes(int vertices, int element) {
+    return ((size_t)3 * vertices * element + 3) & ~(size_t)3;
+}
+
+static char* putVertices(char* p, const float* v, int n, BinaryPrecision precision) {
+    if (precision == BINARY_FLOAT32) {
+        memcpy(p, v, n * sizeof(float));
+        return p + n * sizeof(float);
+    }
+    for (int i = 0; i < n; i++) p = put(p, toHalf(v[i]));
+    return p;
+}
+
+static const char* getVertices(const char* p, float* v, int n, bool half) {
+    if (!half) {
+        memcpy(v, p, n * sizeof(float));
+        return p + n * sizeof(float);
+    }
+    for (int i = 0; i < n; i++) {
+        uint16_t h;
+        p = get(p, h);
+        v[i] = fromHalf(h);
+    }
+    return p;
+}
+
+// Same as it was sent, bit for bit
+static bool sameOnWire(float a, float b, BinaryPrecision precision) {
+    if (precision == BINARY_FLOAT16) return toHalf(a) == toHalf(b);
+    uint32_t x, y;
+    memcpy(&x, &a, sizeof(x));
+    memcpy(&y, &b, sizeof(y));
+    return x == y;
+}
+
+static size_t wholeBytes(const FrameGeometry& geometry, int o, int element) {
+    int first = geometry.objects[o].firstStroke;
+    int last = geometry.objects[o + 1].firstStroke;
+    int vertices = geometry.strokeStart[last] - geometry.strokeStart[first];
+    return wholeHeaderBytes + 4 * (last - first) + vertexBytes(vertices, element);
+}
+
+static size_t headerBytes(bool delta, bool frameInfo) {
+    return OSCI_BINARY_PREFIX_BYTES + 12 + (delta ? 4 : 0) + (frameInfo ? 16 : 0);
+}
+
+static char* putHeader(char* p, size_t length, uint16_t flags, const FrameGeometry& geometry, uint32_t sequence, uint32_t baseSequence) {
+    p = put<uint32_t>(p, OSCI_BINARY_MAGIC);
+    p = put<uint32_t>(p, (uint32_t)length);
+    p = put<uint16_t>(p, OSCI_BINARY_VERSION);
+    p = put<uint16_t>(p, flags);
+    p = put<float>(p, -2.5f);
+    p = put<uint32_t>(p, geometry.objectCount);
+    p = put<uint32_t>(p, sequence);
+    if (flags & BINARY_DELTA) p = put<uint32_t>(p, baseSequence);
+    if (flags & BINARY_FRAME_INFO) {
+        p = put<uint32_t>(p, geometry.frameNumber);
+        p = put<float>(p, geometry.latencyMs);
+        p = put<int64_t>(p, geometry.timestamp);
+    }
+    return p;
+}
+
+// x, y and z of n vertices from start, padded
+static char* putArrays(char* p, const FrameGeometry& geometry, int start, int n, BinaryPrecision precision) {
+    char* arrays = p;
+    p = putVertices(p, geometry.x + start, n, precision);
+    p = putVertices(p, geometry.y + start, n, precision);
+    p = putVertices(p, geometry.z + start, n, precision);
+    // The buffer still holds the last frame, so the padding gets zeroed
+    char* end = arrays + vertexBytes(n, precision == BINARY_FLOAT16 ? 2 : 4);
+    while (p < end) *p++ = 0;
+    return p;
+}
+
+// Object o whole, after its label
+static char* putWhole(char* p, const FrameGeometry& geometry, int o, const float matrix[16], BinaryPrecision precision) {
+    int first = geometry.objects[o].firstStroke;
+    int last = geometry.objects[o + 1].firstStroke;
+    int start = geometry.strokeStart[first];
+    p = put<uint32_t>(p, last - first);
+    p = put<uint32_t>(p, geometry.strokeStart[last] - start);
+    memcpy(p, matrix, 16 * sizeof(float));
+    p += 16 * sizeof(float);
+    for (int s = first; s < last; s++) p = put<uint32_t>(p, geometry.strokeStart[s + 1] - geometry.strokeStart[s]);
+    return putArrays(p, geometry, start, geometry.strokeStart[last] - start, precision);
+}
+
+void writeBinaryScene(const FrameGeometry& geometry, const float matrix[16], bool frameInfo, BinaryPrecision precision, uint32_t sequence, std::string& out) {
+    int element = precision == BINARY_FLOAT16 ? 2 : 4;
+    size_t length = headerBytes(false, frameInfo);
+    for (int o = 0; o < geometry.objectCount; o++) length += 4 + wholeBytes(geometry, o, element);
+    out.resize(length);
+
+    uint16_t flags = (precision == BINARY_FLOAT16 ? BINARY_HALF : 0) | (frameInfo ? BINARY_FRAME_INFO : 0);
+    char* p = putHeader(&out[0], length, flags, geometry, sequence, 0);
+    for (int o = 0; o < geometry.objectCount; o++) {
+        p = put<int32_t>(p, geometry.objects[o].label);
+        p = putWhole(p, geometry, o, matrix, precision);
+    }
+}
+
+DeltaEncoder::DeltaEncoder() : keyframes(0), deltas(0), haveLast(false), sequence(0), sinceKeyframe(0), lastPrecision(BINARY_FLOAT32) {
+    memset(lastMatrix, 0, sizeof(lastMatrix));
+}
+
+void DeltaEncoder::write(const FrameGeometry& geometry, const float matrix[16], bool frameInfo, BinaryPrecision precision, int keyframeInterval, std::string& out) {
+    bool keyframe = !haveLast || precision != lastPrecision || memcmp(matrix, lastMatrix, sizeof(lastMatrix)) || sinceKeyframe + 1 >= keyframeInterval;
+    sequence++;
+    if (keyframe) {
+        writeBinaryScene(geometry, matrix, frameInfo, precision, sequence, out);
+        keyframes++;
+        sinceKeyframe = 0;
+    }
+    else {
+        // Each object as the smallest of same, runs or whole, against the last frame's object with its label
+        int element = precision == BINARY_FLOAT16 ? 2 : 4;
+        size_t length = headerBytes(true, frameInfo);
+        int runs = 0;
+        for (int o = 0; o < geometry.objectCount; o++) {
+            firstRun[o] = runs;
+            kind[o] = DELTA_WHOLE;
+            size_t bytes = 8 + wholeBytes(geometry, o, element);
+            int b = 0;
+            while (b < last.objectCount && last.objects[b].label != geometry.objects[o].label) b++;
+
+            int first = geometry.objects[o].firstStroke;
+            int strokes = geometry.objects[o + 1].firstStroke - first;
+            int lastFirst = b < last.objectCount ? last.objects[b].firstStroke : 0;
+            bool sameStrokes = b < last.objectCount && last.objects[b + 1].firstStroke - lastFirst == strokes;
+            for (int s = 0; sameStrokes && s < strokes; s++) {
+                sameStrokes = geometry.strokeStart[first + s + 1] - geometry.strokeStart[first + s] ==
+                    last.strokeStart[lastFirst + s + 1] - last.strokeStart[lastFirst + s];
+            }
+            if (sameStrokes) {
+                int start = geometry.strokeStart[first];
+                int lastStart = last.strokeStart[lastFirst];
+                int vertices = geometry.strokeStart[first + strokes] - start;
+                for (int i = 0; i < vertices; i++) {
+                    if (sameOnWire(geometry.x[start + i], last.x[lastStart + i], precision) &&
+                        sameOnWire(geometry.y[start + i], last.y[lastStart + i], precision) &&
+                        sameOnWire(geometry.z[start + i], last.z[lastStart + i], precision)) continue;
+                    // Resending a gap costs less than starting a run after it when it's short
+                    int end = runs > firstRun[o] ? runStart[runs - 1] + runLength[runs - 1] : -1;
+                    if (end >= 0 && (i - end) * 3 * element <= 8) runLength[runs - 1] = i - runStart[runs - 1] + 1;
+                    else {
+                        runStart[runs] = i;
+                        runLength[runs] = 1;
+                        runs++;
+                    }
+                }
+                size_t runBytes = 12;
+                for (int r = firstRun[o]; r < runs; r++) runBytes += 8 + vertexBytes(runLength[r], element);
+                if (runs == firstRun[o]) {
+                    kind[o] = DELTA_SAME;
+                    bytes = 8;
+                }
+                else if (runBytes < bytes) {
+                    kind[o] = DELTA_RUNS;
+                    bytes = runBytes;
+                }
+                else runs = firstRun[o];
+            }
+            length += bytes;
+        }
+        firstRun[geometry.objectCount] = runs;
+        out.resize(length);
+
+        uint16_t flags = (precision == BINARY_FLOAT16 ? BINARY_HALF : 0) | (frameInfo ? BINARY_FRAME_INFO : 0) | BINARY_DELTA;
+        char* p = putHeader(&out[0], length, flags, geometry, sequence, sequence - 1);
+        for (int o = 0; o < geometry.objectCount; o++) {
+            p = put<int32_t>(p, geometry.objects[o].label);
+            p = put<uint32_t>(p, kind[o]);
+            if (kind[o] == DELTA_WHOLE) p = putWhole(p, geometry, o, matrix, precision);
+            if (kind[o] != DELTA_RUNS) continue;
+            int start = geometry.strokeStart[geometry.objects[o].firstStroke];
+            p = put<uint32_t>(p, firstRun[o + 1] - firstRun[o]);
+            for (int r = firstRun[o]; r < firstRun[o + 1]; r++) {
+                p = put<uint32_t>(p, runStart[r]);
+                p = put<uint32_t>(p, runLength[r]);
+                p = putArrays(p, geometry, start + runStart[r], runLength[r], precision);
+            }
+        }
+        deltas++;
+        sinceKeyframe++;
+    }
+    copyGeometry(last, geometry);
+    memcpy(lastMatrix, matrix, sizeof(lastMatrix));
+    lastPrecision = precision;
+    haveLast = true;
+}
+
+int64_t binaryMessageLength(const char* data, size_t size) {
+    if (size < OSCI_BINARY_PREFIX_BYTES) return 0;
+    uint32_t magic, length;
+    get(get(data, magic), length);
+    if (magic != OSCI_BINARY_MAGIC || length < OSCI_BINARY_PREFIX_BYTES + 12) return -1;
+    return length;
+}
+
+// Room in the frame for an object of strokes and vertices, which goes on the end
+static bool beginObject(FrameGeometry& geometry, int label, uint32_t strokes, uint32_t vertices) {
+    if (strokes > (uint32_t)(MAX_GEOMETRY_STROKES - geometry.strokeCount) ||
+        vertices > (uint32_t)(MAX_GEOMETRY_VERTICES - geometry.vertexCount)) return false;
+    GeometryObject& object = geometry.objects[geometry.objectCount++];
+    object.label = label;
+    object.firstStroke = geometry.strokeCount;
+    return true;
+}
+
+int64_t readBinaryScene(const char* data, size_t size, const BinaryScene* base, BinaryScene& scene) {
+    int64_t length = binaryMessageLength(data, size);
+    if (length <= 0) return length;
+    if ((size_t)length > size) return 0;
+    const char* p = data + 8;
+    const char* end = data + length;
+    p = get(p, scene.version);
+    p = get(p, scene.flags);
+    if (scene.version != OSCI_BINARY_VERSION) return -1;
+    bool half = (scene.flags & BINARY_HALF) != 0;
+    bool delta = (scene.flags & BINARY_DELTA) != 0;
+    int element = half ? 2 : 4;
+
+    FrameGeometry& geometry = scene.geometry;
+    geometry.clear();
+    geometry.timestamp = 0;
+    geometry.frameNumber = 0;
+    geometry.latencyMs = 0;
+    uint32_t objects, baseSequence = 0;
+    p = get(p, scene.focalLength);
+    p = get(p, objects);
+    p = get(p, scene.sequence);
+    if ((size_t)(end - p) < (delta ? 4u : 0u) + (scene.flags & BINARY_FRAME_INFO ? 16u : 0u)) return -1;
+    if (delta) p = get(p, baseSequence);
+    if (scene.flags & BINARY_FRAME_INFO) {
+        p = get(p, geometry.frameNumber);
+        p = get(p, geometry.latencyMs);
+        p = get(p, geometry.timestamp);
+    }
+    if (objects > MAX_GEOMETRY_OBJECTS) return -1;
+    if (delta && (base == NULL || base == &scene || base->sequence != baseSequence)) return BINARY_NO_BASE;
+
+    for (uint32_t o = 0; o < objects; o++) {
+        int32_t label;
+        uint32_t kind = DELTA_WHOLE;
+        if ((size_t)(end - p) < (delta ? 8u : 4u)) return -1;
+        p = get(p, label);
+        if (delta) p = get(p, kind);
+        int start = geometry.vertexCount;
+
+        if (kind == DELTA_WHOLE) {
+            uint32_t strokes, vertices;
+            if (end - p < wholeHeaderBytes) return -1;
+            p = get(p, strokes);
+            p = get(p, vertices);
+            if (!beginObject(geometry, label, strokes, vertices) ||
+                (size_t)(end - p) < 16 * sizeof(float) + 4 * strokes + vertexBytes(vertices, element)) return -1;
+            memcpy(scene.matrix[o], p, 16 * sizeof(float));
+            p += 16 * sizeof(float);
+            for (uint32_t s = 0; s < strokes; s++) {
+                uint32_t count;
+                p = get(p, count);
+                if (count > vertices - (uint32_t)(geometry.vertexCount - start)) return -1;
+                geometry.vertexCount += count;
+                geometry.strokeStart[++geometry.strokeCount] = geometry.vertexCount;
+            }
+            if ((uint32_t)(geometry.vertexCount - start) != vertices) return -1;
+            const char* arrays = p;
+            p = getVertices(p, geometry.x + start, vertices, half);
+            p = getVertices(p, geometry.y + start, vertices, half);
+            p = getVertices(p, geometry.z + start, vertices, half);
+            p = arrays + vertexBytes(vertices, element);
+            continue;
+        }
+
+        // The base's object with this label, then the runs on top of it
+        if (kind != DELTA_SAME && kind != DELTA_RUNS) return -1;
+        const FrameGeometry& from = base->geometry;
+        int b = 0;
+        while (b < from.objectCount && from.objects[b].label != label) b++;
+        if (b == from.objectCount) return -1;
+        int first = from.objects[b].firstStroke;
+        int strokes = from.objects[b + 1].firstStroke - first;
+        int fromStart = from.strokeStart[first];
+        int vertices = from.strokeStart[first + strokes] - fromStart;
+        if (!beginObject(geometry, label, strokes, vertices)) return -1;
+        memcpy(scene.matrix[o], base->matrix[b], 16 * sizeof(float));
+        for (int s = 0; s < strokes; s++) {
+            geometry.vertexCount += from.strokeStart[first + s + 1] - from.strokeStart[first + s];
+            geometry.strokeStart[++geometry.strokeCount] = geometry.vertexCount;
+        }
+        memcpy(geometry.x + start, from.x + fromStart, vertices * sizeof(float));
+        memcpy(geometry.y + start, from.y + fromStart, vertices * sizeof(float));
+        memcpy(geometry.z + start, from.z + fromStart, vertices * sizeof(float));
+        if (kind == DELTA_SAME) continue;
+
+        uint32_t runs;
+        if (end - p < 4) return -1;
+        p = get(p, runs);
+        for (uint32_t r = 0; r < runs; r++) {
+            uint32_t at, count;
+            if (end - p < 8) return -1;
+            p = get(p, at);
+            p = get(p, count);
+            if (at > (uint32_t)vertices || count > (uint32_t)vertices - at || (size_t)(end - p) < vertexBytes(count, element)) return -1;
+            const char* arrays = p;
+            p = getVertices(p, geometry.x + start + at, count, half);
+            p = getVertices(p, geometry.y + start + at, count, half);
+            p = getVertices(p, geometry.z + start + at, count, half);
+            p = arrays + vertexBytes(count, element);
+        }
+    }
+    geometry.objects[geometry.objectCount].firstStroke = geometry.strokeCount;
+    return p == end ? length : -1;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "Geometry.h"
+
+// A binary framing of the osci-render scene, for receivers that opt in. Little endian, every
+// field on a 4 byte boundary, and sized up front, so a reader finds each array from the counts
+// before it without scanning:
+//
+//   prefix   uint32 magic "ORKB", uint32 length of the whole message, uint16 version, uint16 flags
+//   header   float focalLength, uint32 objectCount, uint32 sequence
+//            with BINARY_DELTA: uint32 baseSequence
+//            with BINARY_FRAME_INFO: uint32 frameNumber, float latencyMs, int64 timestamp
+//   objects  int32 label, then in a delta uint32 kind, then for a whole object:
+//            uint32 strokeCount, uint32 vertexCount, float matrix[16],
+//            uint32 strokeLength[strokeCount], then x, y and z of every vertex, each
+//            vertexCount floats or with BINARY_HALF halves, padded to 4 bytes
+//
+// A keyframe has every object whole. A delta has every object of the frame too, in order, but
+// those the message baseSequence names has under the same label can be DELTA_SAME, nothing
+// more, or DELTA_RUNS with the same strokes and only the vertices that changed:
+//
+//   runs     uint32 runCount, then each run uint32 first vertex of the object, uint32 count,
+//            x, y and z of those vertices as above, padded to 4 bytes
+//
+// An object labeled 0 is the idle line art, any other label is "Skeleton <label>".
+
+#define OSCI_BINARY_MAGIC 0x424B524F     // "ORKB"
+#define OSCI_BINARY_VERSION 2
+#define OSCI_BINARY_PREFIX_BYTES 12
+
+// Flags
+#define BINARY_HALF 1                   // Vertices as IEEE half floats
+#define BINARY_FRAME_INFO 2
+#define BINARY_DELTA 4
+
+// Delta object kinds
+#define DELTA_SAME 0
+#define DELTA_WHOLE 1
+#define DELTA_RUNS 2
+
+enum BinaryPrecision {
+    BINARY_FLOAT32 = 0,
+    BINARY_FLOAT16                      // Half the vertex bytes, about 4 mm steps at 8 m
+};
+
+// The geometry frame as one keyframe in out, every object with the same matrix. out is kept
+// between frames, so once it has grown to the frame size nothing more is allocated.
+void writeBinaryScene(const FrameGeometry& geometry, const float matrix[16], bool frameInfo, BinaryPrecision precision, uint32_t sequence, std::string& out);
+
+// Writes each frame as a delta against the one before it, or as a keyframe every
+// keyframeInterval messages and whenever the matrix or precision changes. The stream goes over
+// TCP, so what was sent is what the receiver has and the keyframes are for receivers that
+// join late or lose their place. A vertex counts as changed when what goes on the wire does,
+// so the decoded deltas are exactly the decoded keyframes.
+class DeltaEncoder {
+public:
+    DeltaEncoder();
+
+    // keyframeInterval 1 sends every frame whole
+    void write(const FrameGeometry& geometry, const float matrix[16], bool frameInfo, BinaryPrecision precision, int keyframeInterval, std::string& out);
+    // The next message is a keyframe
+    void reset() { haveLast = false; }
+
+    uint64_t keyframes;
+    uint64_t deltas;
+
+private:
+    bool haveLast;
+    uint32_t sequence;
+    int sinceKeyframe;
+    BinaryPrecision lastPrecision;
+    float lastMatrix[16];
+    FrameGeometry last;
+    // This delta's objects and their runs, vertex indices within the object
+    int kind[MAX_GEOMETRY_OBJECTS];
+    int firstRun[MAX_GEOMETRY_OBJECTS + 1];
+    int runStart[MAX_GEOMETRY_VERTICES];
+    int runLength[MAX_GEOMETRY_VERTICES];
+};
+
+// What the reference decoder reads back
+struct BinaryScene {
+    uint16_t version;
+    uint16_t flags;
+    uint32_t sequence;
+    float focalLength;
+    FrameGeometry geometry;             // With the frame info when the message has it
+    float matrix[MAX_GEOMETRY_OBJECTS][16];
+};
+
+// The length of the message data starts with, from its prefix. 0 while fewer than
+// OSCI_BINARY_PREFIX_BYTES are there, -1 if it doesn't start a message.
+int64_t binaryMessageLength(const char* data, size_t size);
+
+#define BINARY_NO_BASE (-2)
+
+// Decodes the message data starts with into scene, a delta on top of base, the scene the
+// message before it decoded to. Returns its length, 0 if it hasn't all arrived, -1 if it isn't a
+// message this version reads or doesn't fit a geometry frame, or BINARY_NO_BASE for a delta
+// when base is NULL or another frame, and the receiver has to wait for the next keyframe.
+int64_t readBinaryScene(const char* data, size_t size, const BinaryScene* base, BinaryScene& scene);
@@ -0,0 +1,162 @@
+#include "OsciJson.h"
+
+#include <math.h>
+#include <charconv>
+
+// Pulls every object toward the camera, as osci-render expects
+static const char objectMatrix[] = "[1,0,0,0,0,1,0,0,0,0,-1,-1,0,0,-1,1]";
+
+static void appendInteger(std::string& out, long long value) {
+    char text[24];
+    char* end = std::to_chars(text, text + sizeof(text), value).ptr;
+    out.append(text, end - text);
+}
+
+// Floats go out as the double they widen to, with ".0" on whole numbers and null for NaN and infinity
+static void appendFloat(std::string& out, float value) {
+    if (!isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char text[32];
+    char* end = std::to_chars(text, text + sizeof(text), (double)value).ptr;
+    bool whole = true;
+    for (char* c = text; c < end; c++) {
+        if (*c == '.' || *c == 'e') whole = false;
+    }
+    out.append(text, end - text);
+    if (whole) out += ".0";
+}
+
+static const char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const int64_t powersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+
+// Writes value's digits ending at end, two at a time, at least width of them. Returns the first.
+static char* writeDigits(char* end, uint64_t value, int width) {
+    char* p = end;
+    while (value >= 100) {
+        const char* pair = digitPairs + 2 * (value % 100);
+        value /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (value >= 10) {
+        *--p = digitPairs[2 * value + 1];
+        *--p = digitPairs[2 * value];
+    }
+    else *--p = (char)('0' + value);
+    while (end - p < width) *--p = '0';
+    return p;
+}
+
+// units / 10^decimals, with the trailing zeros dropped down to ".0"
+static void appendFixed(std::string& out, int64_t units, int decimals) {
+    char text[40];
+    char* end = text + sizeof(text);
+    uint64_t magnitude = units < 0 ? 0 - (uint64_t)units : (uint64_t)units;
+    uint64_t whole = magnitude / powersOf10[decimals];
+    uint64_t fraction = magnitude % powersOf10[decimals];
+    while (decimals > 1 && fraction % 10 == 0) {
+        fraction /= 10;
+        decimals--;
+    }
+    char* p = decimals > 0 ? writeDigits(end, fraction, decimals) : end;
+    if (decimals == 0) *--p = '0';
+    *--p = '.';
+    p = writeDigits(p, whole, 1);
+    if (units < 0) *--p = '-';
+    out.append(p, end - p);
+}
+
+// How a grid's steps go out: in units of 10^-decimals, step units each when the grid is a whole
+// number of them, so every vertex is integer arithmetic, or else rounded from the grid in meters
+struct FixedPoint {
+    int decimals;
+    int64_t step;
+    double scale;
+};
+
+static FixedPoint fixedPoint(float grid) {
+    FixedPoint fixed = { 6, 0, 1e6 * grid };
+    for (int d = 0; d <= 6; d++) {
+        double units = grid * (double)powersOf10[d];
+        double rounded = floor(units + 0.5);
+        if (rounded >= 1 && fabs(units - rounded) < 1e-4 * rounded) {
+            fixed.decimals = d;
+            fixed.step = (int64_t)rounded;
+            break;
+        }
+    }
+    return fixed;
+}
+
+static void appendStep(std::string& out, int32_t q, const FixedPoint& fixed) {
+    int64_t units = fixed.step ? q * fixed.step : llround(q * fixed.scale);
+    appendFixed(out, units, fixed.decimals);
+}
+
+void writeScene(const FrameGeometry& geometry, bool frameInfo, std::string& out) {
+    out.clear();
+    FixedPoint fixed = fixedPoint(geometry.grid);
+    out += "{\"focalLength\":-2.5";
+    if (frameInfo) {
+        out += ",\"frameNumber\":";
+        appendInteger(out, geometry.frameNumber);
+        out += ",\"latencyMs\":";
+        appendFloat(out, geometry.latencyMs);
+    }
+    if (geometry.objectCount > 0) {
+        out += ",\"objects\":[";
+        for (int o = 0; o < geometry.objectCount; o++) {
+            if (o > 0) out.push_back(',');
+            out += "{\"matrix\":";
+            out += objectMatrix;
+            out += ",\"name\":\"Skeleton ";
+            appendInteger(out, geometry.objects[o].label);
+            out.push_back('"');
+
+            int first = geometry.objects[o].firstStroke;
+            int last = geometry.objects[o + 1].firstStroke;
+            if (last > first) {
+                out += ",\"vertices\":[";
+                for (int s = first; s < last; s++) {
+                    if (s > first) out.push_back(',');
+                    out.push_back('[');
+                    for (int i = geometry.strokeStart[s]; i < geometry.strokeStart[s + 1]; i++) {
+                        if (i > geometry.strokeStart[s]) out.push_back(',');
+                        if (geometry.grid > 0) {
+                            out += "{\"x\":";
+                            appendStep(out, geometry.qx[i], fixed);
+                            out += ",\"y\":";
+                            appendStep(out, geometry.qy[i], fixed);
+                            out += ",\"z\":";
+                            appendStep(out, geometry.qz[i], fixed);
+                            out.push_back('}');
+                            continue;
+                        }
+                        out += "{\"x\":";
+                        appendFloat(out, geometry.x[i]);
+                        out += ",\"y\":";
+                        appendFloat(out, geometry.y[i]);
+                        out += ",\"z\":";
+                        appendFloat(out, geometry.z[i]);
+                        out.push_back('}');
+                    }
+                    out.push_back(']');
+                }
+                out.push_back(']');
+            }
+            out.push_back('}');
+        }
+        out.push_back(']');
+    }
+    if (frameInfo) {
+        out += ",\"timestamp\":";
+        appendInteger(out, geometry.timestamp);
+    }
+    out.push_back('}');
+}
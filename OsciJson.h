@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+#include "Geometry.h"
+
+// Writes a geometry frame as the JSON scene osci-render reads, straight into a string that is
+// kept between frames, so once it has grown to the frame size nothing more is allocated.
+// The same scene nlohmann::json's dump() gave: keys in sorted order, no spaces, floats as the
+// shortest text that reads back as the same double. Where two are as short it may pick the
+// other one in the last digit. A frame on a grid prints its vertices in fixed point instead,
+// to as many decimals as the grid has, straight from the grid steps.
+void writeScene(const FrameGeometry& geometry, bool frameInfo, std::string& out);
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "Frames.h"
+#include "FrameSource.h"
+#include "Geometry.h"
+#include "History.h"
+#include "Interpolation.h"
+#include "JointFilter.h"
+#include "Prediction.h"
+#include "Primitives.h"
+#include "Skeletons.h"
+
+// The output pipeline main.cpp runs, skeleton frames in and osci-render scenes out, as far as
+// the checks drive it
+
+// This frame's output geometry and the last one's, to only send what changed
+extern FrameGeometry geometryFrames[2];
+extern int geometryFrame;
+extern bool geometryChanged;
+
+extern bool headCube;
+extern bool headIco;
+extern bool handCube;
+extern bool footCube;
+extern glm::vec3 headCubeRotation;
+extern glm::vec3 headIcoRotation;
+extern glm::vec3 handCubeRotationL;
+extern glm::vec3 handCubeRotationR;
+extern glm::vec3 footCubeRotationL;
+extern glm::vec3 footCubeRotationR;
+
+// Command line options for the source
+extern int syntheticBodies;
+extern float syntheticFps;
+extern const char* playbackPath;
+extern float playbackSpeed;
+extern bool playbackLoop;
+
+extern int activeSkeletons;
+extern BodyStore bodies;
+extern MeshBatch primitives;
+extern JointFilterSettings jointFilterSettings;
+extern JointFilter jointFilter;
+extern PredictionSettings prediction;
+extern JointHistory history;
+extern InterpolationMode interpolation;
+extern bool sendFrameInfo;
+extern float gridMm;
+
+// Every skeleton object's matrix, and the idle frame's
+extern const float skeletonMatrix[16];
+extern const float idleMatrix[16];
+
+// Source for sensor index, NULL if it can't be opened
+FrameSource* openSource(int index);
+void getSkeletonData(const SkeletonFrame& sF);
+void bodyPoints(const BodyStore& store, int b, glm::vec4 sp[JOINT_COUNT]);
+const BodyStore& outputBodies();
+bool skeletate(FrameGeometry& geometry, glm::vec4 sp[JOINT_COUNT], int b, const MeshBatch& batch, int first, int last);
+void makeGeometry();
+void geometryJson(const FrameGeometry& geometry, std::string& j);
+const FrameGeometry& idleGeometry();
+bool serializeOsciRender(std::string& j);
+void spinPrimitives(float delt);
@@ -0,0 +1,109 @@
+#include "Prediction.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <vector>
+
+JointPredictor::JointPredictor() : count(0) {
+}
+
+void JointPredictor::update(const JointHistory& history) {
+    count = history.count();
+    history.velocity(vx, vy, vz);
+    history.acceleration(ax, ay, az);
+}
+
+void JointPredictor::predict(const BodyStore& store, float seconds, bool acceleration, BodyStore& out) const {
+    out = store;
+    if (seconds <= 0 || count != store.count) return;
+
+    // The active bodies are contiguous, so every joint of every body goes in one loop
+    int n = store.count * JOINT_COUNT;
+    float h = seconds;
+    float hh = acceleration ? 0.5f * seconds * seconds : 0;
+    const float* x = store.x[0];
+    const float* y = store.y[0];
+    const float* z = store.z[0];
+    const float* vx0 = vx[0];
+    const float* vy0 = vy[0];
+    const float* vz0 = vz[0];
+    const float* ax0 = ax[0];
+    const float* ay0 = ay[0];
+    const float* az0 = az[0];
+    float* ox = out.x[0];
+    float* oy = out.y[0];
+    float* oz = out.z[0];
+    for (int i = 0; i < n; i++) {
+        ox[i] = x[i] + vx0[i] * h + ax0[i] * hh;
+        oy[i] = y[i] + vy0[i] * h + ay0[i] * hh;
+        oz[i] = z[i] + vz0[i] * h + az0[i] * hh;
+    }
+}
+
+bool benchPrediction(FrameSource* source, int frames, float noiseMm, const JointFilterSettings& filterSettings) {
+    std::vector<SkeletonFrame> recorded;
+    readSkeletonFrames(source, frames, recorded);
+    int n = (int)recorded.size();
+    if (n < 8) {
+        printf("Not enough skeleton frames to predict\n");
+        return false;
+    }
+    addJointNoise(recorded, noiseMm);
+    float dt = (recorded[n - 1].timestamp - recorded[0].timestamp) / 1000.0f / (n - 1);
+    if (dt <= 0) dt = 1.0f / 30;
+
+    // Where the filtered joints really were, then the predictions from each frame against it
+    BodyTrack actual;
+    filterTrack(recorded, filterSettings, actual);
+
+    const int horizons = 6;
+    const int methods = 3;
+    std::vector<float> errors[horizons][methods];
+    static BodyStore store, predicted;
+    store = BodyStore();
+    JointFilter filter;
+    static JointHistory history;
+    history.reset();
+    JointPredictor predictor;
+    for (int f = 0; f < n; f++) {
+        float frameDt = f > 0 ? (recorded[f].timestamp - recorded[f - 1].timestamp) / 1000.0f : 0;
+        updateBodies(store, recorded[f]);
+        filter.apply(store, filterSettings, frameDt);
+        history.push(store);
+        predictor.update(history);
+        for (int k = 1; k <= horizons; k++) {
+            for (int m = 0; m < methods; m++) {
+                predictor.predict(store, m == 0 ? 0 : k * dt, m == 2, predicted);
+                for (int b = 0; b < predicted.count; b++) {
+                    int l = predicted.label[b] - 1;
+                    for (int i = 0; i < JOINT_COUNT; i++) {
+                        // Only from bodies seen for long enough to have an acceleration
+                        if (!actual.continuous(f - 2, f + k, l, i)) continue;
+                        glm::vec3 p(predicted.x[b][i], predicted.y[b][i], predicted.z[b][i]);
+                        errors[k - 1][m].push_back(glm::length(p - actual.position[actual.index(f + k, l, i)]) * 1000);
+                    }
+                }
+            }
+        }
+    }
+
+    printf("%d frames, %.1f ms apart, %.1f mm of added noise, error against the filtered joints\n", n, dt * 1000, noiseMm);
+    printf("%-10s %20s %20s %20s\n", "ahead ms", "hold mean/p95 mm", "velocity mean/p95", "accel mean/p95");
+    for (int k = 0; k < horizons; k++) {
+        printf("%-10.1f", (k + 1) * dt * 1000);
+        for (int m = 0; m < methods; m++) {
+            std::vector<float>& e = errors[k][m];
+            if (e.empty()) {
+                printf(" %20s", "-");
+                continue;
+            }
+            double sum = 0;
+            for (float v : e) sum += v;
+            std::sort(e.begin(), e.end());
+            printf(" %11.2f/%-8.2f", sum / e.size(), e[e.size() * 95 / 100]);
+        }
+        printf("\n");
+    }
+    return true;
+}
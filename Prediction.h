@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Frames.h"
+#include "FrameSource.h"
+#include "History.h"
+#include "JointFilter.h"
+#include "Skeletons.h"
+
+// Extrapolates the filtered joints along their velocity and acceleration, to make up for the
+// time between the sensor seeing a pose and osci-render drawing it.
+
+struct PredictionSettings {
+    bool enabled = false;
+    float extraMs = 0;          // Added to the measured latency, for the network, parsing and drawing
+    float maxMs = 150;          // Longest horizon, further out the extrapolation mostly adds error
+    bool acceleration = true;   // Or extrapolate with the velocity only
+};
+
+// Velocity and acceleration of the bodies in one store, from its history
+class JointPredictor {
+public:
+    JointPredictor();
+
+    // Takes the newest velocities and accelerations, call after every history push
+    void update(const JointHistory& history);
+
+    // The store's bodies extrapolated seconds ahead into out, one pass over every joint of every body
+    void predict(const BodyStore& store, float seconds, bool acceleration, BodyStore& out) const;
+
+private:
+    int count;
+    alignas(64) float vx[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float vy[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float vz[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float ax[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float ay[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float az[SKELETON_COUNT][JOINT_COUNT];
+};
+
+// Replays up to frames skeleton frames, with noiseMm of added noise, through the filter and
+// reports the error of predicting 1 to 6 frames ahead against where the filtered joints really
+// ended up: holding the last position, with the velocity only and with the acceleration too.
+// Returns false without frames.
+bool benchPrediction(FrameSource* source, int frames, float noiseMm, const JointFilterSettings& filter);
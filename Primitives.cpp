@@ -0,0 +1,220 @@
+#include "Primitives.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// One stroke around the edges
+static constexpr float cubeVertices[16][3] = {
+    { -1.f, -1.f, -1.f },
+    { -1.f, -1.f, 1.f },
+    { -1.f, 1.f, 1.f },
+    { 1.f, 1.f, 1.f },
+    { 1.f, 1.f, -1.f },
+    { -1.f, 1.f, -1.f },
+    { -1.f, -1.f, -1.f },
+    { 1.f, -1.f, -1.f },
+    { 1.f, -1.f, 1.f },
+    { -1.f, -1.f, 1.f },
+    { -1.f, 1.f, 1.f },
+    { -1.f, 1.f, -1.f },
+    { 1.f, 1.f, -1.f },
+    { 1.f, -1.f, -1.f },
+    { 1.f, -1.f, 1.f },
+    { 1.f, 1.f, 1.f }
+};
+static constexpr int cubeStrokes[] = { 0, 16 };
+
+// 18 strokes that cover the 30 edges
+static constexpr float icoVertices[48][3] = {
+    { -0.4472150206565857, -0.5257200002670288, -0.7235999703407288 },
+    { 0.4472149908542633, -0.8506399989128113, -0.27638503909111023 },
+    { 0.4472149908542633, -0.8506399989128113, -0.27638503909111023 },
+    { -0.4472149908542633, -0.8506399989128113, 0.27638503909111023 },
+    { -0.4472149610519409, 0.0, 0.8944249749183655 },
+    { -1.0, 0.0, 4.371138828673793e-08 },
+    { -1.0, 0.0, 4.371138828673793e-08 },
+    { -0.4472149908542633, 0.8506399989128113, 0.27638503909111023 },
+    { -0.4472149908542633, 0.8506399989128113, 0.27638503909111023 },
+    { -0.4472150206565857, 0.5257200002670288, -0.7235999703407288 },
+    { 0.4472149610519409, 0.0, -0.8944249749183655 },
+    { -0.4472150206565857, -0.5257200002670288, -0.7235999703407288 },
+    { -0.4472150206565857, -0.5257200002670288, -0.7235999703407288 },
+    { -0.4472150206565857, 0.5257200002670288, -0.7235999703407288 },
+    { -0.4472150206565857, 0.5257200002670288, -0.7235999703407288 },
+    { -1.0, 0.0, 4.371138828673793e-08 },
+    { -0.4472150206565857, -0.5257200002670288, -0.7235999703407288 },
+    { -0.4472149908542633, -0.8506399989128113, 0.27638503909111023 },
+    { -0.4472149908542633, -0.8506399989128113, 0.27638503909111023 },
+    { -1.0, 0.0, 4.371138828673793e-08 },
+    { -0.4472149908542633, -0.8506399989128113, 0.27638503909111023 },
+    { 0.4472150206565857, -0.5257200002670288, 0.7235999703407288 },
+    { 0.4472150206565857, -0.5257200002670288, 0.7235999703407288 },
+    { -0.4472149610519409, 0.0, 0.8944249749183655 },
+    { -0.4472149908542633, 0.8506399989128113, 0.27638503909111023 },
+    { 0.4472150206565857, 0.5257200002670288, 0.7235999703407288 },
+    { 0.4472150206565857, 0.5257200002670288, 0.7235999703407288 },
+    { -0.4472149610519409, 0.0, 0.8944249749183655 },
+    { -0.4472149908542633, 0.8506399989128113, 0.27638503909111023 },
+    { 0.4472149908542633, 0.8506399989128113, -0.27638503909111023 },
+    { 0.4472149908542633, 0.8506399989128113, -0.27638503909111023 },
+    { -0.4472150206565857, 0.5257200002670288, -0.7235999703407288 },
+    { 0.4472149610519409, 0.0, -0.8944249749183655 },
+    { 1.0, 0.0, -4.371138828673793e-08 },
+    { 1.0, 0.0, -4.371138828673793e-08 },
+    { 0.4472149908542633, -0.8506399989128113, -0.27638503909111023 },
+    { 0.4472149908542633, -0.8506399989128113, -0.27638503909111023 },
+    { 0.4472150206565857, -0.5257200002670288, 0.7235999703407288 },
+    { 0.4472150206565857, 0.5257200002670288, 0.7235999703407288 },
+    { 0.4472149908542633, 0.8506399989128113, -0.27638503909111023 },
+    { 0.4472149908542633, 0.8506399989128113, -0.27638503909111023 },
+    { 0.4472149610519409, 0.0, -0.8944249749183655 },
+    { 0.4472149908542633, -0.8506399989128113, -0.27638503909111023 },
+    { 0.4472150206565857, 0.5257200002670288, 0.7235999703407288 },
+    { 1.0, 0.0, -4.371138828673793e-08 },
+    { 0.4472150206565857, -0.5257200002670288, 0.7235999703407288 },
+    { 1.0, 0.0, -4.371138828673793e-08 },
+    { 0.4472149908542633, 0.8506399989128113, -0.27638503909111023 },
+};
+static constexpr int icoStrokes[] = { 0, 2, 6, 8, 12, 14, 18, 20, 22, 26, 28, 30, 32, 34, 36, 40, 43, 46, 48 };
+
+// The tables as written, one array per component
+template <int N> struct VertexArrays {
+    float x[N], y[N], z[N];
+};
+
+template <int N> constexpr VertexArrays<N> splitVertices(const float (&vertices)[N][3]) {
+    VertexArrays<N> out = {};
+    for (int i = 0; i < N; i++) {
+        out.x[i] = vertices[i][0];
+        out.y[i] = vertices[i][1];
+        out.z[i] = vertices[i][2];
+    }
+    return out;
+}
+
+static constexpr VertexArrays<16> cubeArrays = splitVertices(cubeVertices);
+static constexpr VertexArrays<48> icoArrays = splitVertices(icoVertices);
+
+const WireMesh cubeMesh = { cubeArrays.x, cubeArrays.y, cubeArrays.z, cubeStrokes, 1, 16 };
+const WireMesh icoMesh = { icoArrays.x, icoArrays.y, icoArrays.z, icoStrokes, 18, 48 };
+
+glm::mat3 primitiveRotation(glm::vec3 angles) {
+    float sx = sinf(angles.x), cx = cosf(angles.x);
+    float sy = sinf(angles.y), cy = cosf(angles.y);
+    float sz = sinf(angles.z), cz = cosf(angles.z);
+    // Rz * Ry * Rx, by columns
+    return glm::mat3(
+        cy * cz, cy * sz, -sy,
+        sx * sy * cz - cx * sz, sx * sy * sz + cx * cz, sx * cy,
+        cx * sy * cz + sx * sz, cx * sy * sz - sx * cz, cx * cy);
+}
+
+glm::mat4 primitiveTransform(glm::vec3 root, glm::vec3 angles, float scale) {
+    glm::mat4 m = glm::mat4(primitiveRotation(angles) * scale);
+    m[3] = glm::vec4(root, 1);
+    return m;
+}
+
+bool MeshBatch::add(const WireMesh& mesh, const glm::mat4& transform) {
+    if (count == MAX_MESH_INSTANCES) return false;
+    this->mesh[count] = &mesh;
+    this->transform[count] = transform;
+    vertexStart[count + 1] = vertexStart[count] + mesh.vertexCount;
+    count++;
+    return true;
+}
+
+void transformBatch(MeshBatch& batch) {
+    for (int k = 0; k < batch.count; k++) {
+        const WireMesh& mesh = *batch.mesh[k];
+        // In locals, so the compiler knows the stores below can't change them
+        const glm::mat4& m = batch.transform[k];
+        float m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+        float m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+        float m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
+        float m30 = m[3][0], m31 = m[3][1], m32 = m[3][2];
+        const float* vx = mesh.x;
+        const float* vy = mesh.y;
+        const float* vz = mesh.z;
+        float* x = batch.x + batch.vertexStart[k];
+        float* y = batch.y + batch.vertexStart[k];
+        float* z = batch.z + batch.vertexStart[k];
+        int n = mesh.vertexCount;
+        for (int i = 0; i < n; i++) {
+            x[i] = m00 * vx[i] + m10 * vy[i] + m20 * vz[i] + m30;
+            y[i] = m01 * vx[i] + m11 * vy[i] + m21 * vz[i] + m31;
+            z[i] = m02 * vx[i] + m12 * vy[i] + m22 * vz[i] + m32;
+        }
+    }
+}
+
+// The way the vertices were transformed before the batch, Rodrigues' formula once per axis
+static glm::vec3 rotateAxis(glm::vec3 v, glm::vec3 k, float theta) {
+    float sinTheta = sinf(theta);
+    float cosTheta = cosf(theta);
+    return (v * cosTheta) + (glm::cross(k, v) * sinTheta) + (k * glm::dot(k, v)) * (1 - cosTheta);
+}
+
+static glm::vec3 perVertex(const WireMesh& mesh, int i, glm::vec3 root, glm::vec3 angles, float scale) {
+    glm::vec3 v = glm::vec3(mesh.x[i], mesh.y[i], mesh.z[i]) * scale;
+    v = rotateAxis(v, glm::vec3(1, 0, 0), angles.x);
+    v = rotateAxis(v, glm::vec3(0, 1, 0), angles.y);
+    v = rotateAxis(v, glm::vec3(0, 0, 1), angles.z);
+    return root + v;
+}
+
+bool benchPrimitives(int frames) {
+    typedef std::chrono::steady_clock clock;
+    const int bodies = 6;
+    static MeshBatch batch;
+    static glm::vec3 reference[MAX_MESH_INSTANCES * MAX_MESH_VERTICES];
+    float maxError = 0;
+
+    printf("%d bodies, cubes and icosahedra alternating, us per frame\n", bodies);
+    printf("%-10s %10s %22s %22s %8s\n", "per body", "vertices", "per vertex p50/p99/max", "batch p50/p99/max", "speedup");
+    for (int perBody = 1; perBody <= 64; perBody *= 4) {
+        int instances = bodies * perBody;
+        std::vector<double> perVertexUs, batchUs;
+        for (int f = 0; f < frames; f++) {
+            // Every instance somewhere else and turned some other way each frame
+            clock::time_point t0 = clock::now();
+            int n = 0;
+            for (int k = 0; k < instances; k++) {
+                const WireMesh& mesh = k % 2 ? icoMesh : cubeMesh;
+                glm::vec3 root(k * 0.01f, f * 0.001f, 2.5f);
+                glm::vec3 angles(f * 0.05f + k, f * 0.03f, f * 0.02f - k);
+                for (int i = 0; i < mesh.vertexCount; i++) reference[n++] = perVertex(mesh, i, root, angles, 0.1f);
+            }
+            clock::time_point t1 = clock::now();
+            batch.clear();
+            for (int k = 0; k < instances; k++) {
+                const WireMesh& mesh = k % 2 ? icoMesh : cubeMesh;
+                glm::vec3 root(k * 0.01f, f * 0.001f, 2.5f);
+                glm::vec3 angles(f * 0.05f + k, f * 0.03f, f * 0.02f - k);
+                batch.add(mesh, primitiveTransform(root, angles, 0.1f));
+            }
+            transformBatch(batch);
+            clock::time_point t2 = clock::now();
+            perVertexUs.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+            batchUs.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+
+            for (int i = 0; i < n; i++) {
+                glm::vec3 d = glm::abs(reference[i] - glm::vec3(batch.x[i], batch.y[i], batch.z[i]));
+                maxError = std::max(maxError, std::max(d.x, std::max(d.y, d.z)));
+            }
+        }
+        std::sort(perVertexUs.begin(), perVertexUs.end());
+        std::sort(batchUs.begin(), batchUs.end());
+        size_t p99 = std::min(perVertexUs.size() - 1, perVertexUs.size() * 99 / 100);
+        size_t half = perVertexUs.size() / 2;
+        printf("%-10d %10d %8.1f/%6.1f/%6.1f %8.1f/%6.1f/%6.1f %7.1fx\n", perBody, batch.vertexStart[batch.count],
+            perVertexUs[half], perVertexUs[p99], perVertexUs.back(), batchUs[half], batchUs[p99], batchUs.back(),
+            perVertexUs[half] / std::max(batchUs[half], 0.001));
+    }
+    bool ok = maxError < 1e-5f;
+    printf("Largest difference %g m, %s\n", maxError, ok ? "ok" : "MISMATCH");
+    return ok;
+}
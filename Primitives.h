@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Wireframes drawn around joints: flat tables of unit vertices, split into strokes by offsets.
+// Every instance gets one matrix per frame, and all their vertices are transformed in one batch.
+
+struct WireMesh {
+    const float* x;             // Unit vertices, one array per component
+    const float* y;
+    const float* z;
+    const int* strokeStart;     // Stroke s is vertices [strokeStart[s], strokeStart[s + 1])
+    int strokeCount;
+    int vertexCount;
+};
+
+extern const WireMesh cubeMesh;
+extern const WireMesh icoMesh;
+
+#define MAX_MESH_VERTICES 48
+#define MAX_MESH_INSTANCES 512
+
+// Rotation about x, then y, then z, by the angles in radians
+glm::mat3 primitiveRotation(glm::vec3 angles);
+
+// Scaled, then rotated, then moved to root
+glm::mat4 primitiveTransform(glm::vec3 root, glm::vec3 angles, float scale);
+
+// The mesh instances of one frame and their transformed vertices, one array per component.
+// Big, keep it in static storage.
+struct MeshBatch {
+    int count = 0;
+    const WireMesh* mesh[MAX_MESH_INSTANCES];
+    glm::mat4 transform[MAX_MESH_INSTANCES];
+    int vertexStart[MAX_MESH_INSTANCES + 1] = { 0 };   // Instance k is vertices [vertexStart[k], vertexStart[k + 1])
+    alignas(64) float x[MAX_MESH_INSTANCES * MAX_MESH_VERTICES];
+    alignas(64) float y[MAX_MESH_INSTANCES * MAX_MESH_VERTICES];
+    alignas(64) float z[MAX_MESH_INSTANCES * MAX_MESH_VERTICES];
+
+    void clear() { count = 0; }
+    // False once the batch is full
+    bool add(const WireMesh& mesh, const glm::mat4& transform);
+};
+
+// Every vertex of every instance through its instance's matrix
+void transformBatch(MeshBatch& batch);
+
+// Times building the primitives of 1 to 64 instances per body for 6 bodies, vertex by vertex
+// with a rotation per axis as it used to be, against the batch. Returns false if they disagree.
+bool benchPrimitives(int frames);
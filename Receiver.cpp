@@ -0,0 +1,149 @@
+#include "Receiver.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "CpuTime.h"
+#include "Net.h"
+#include "OsciBinary.h"
+
+// What arrived since the last report
+struct ReceiveStats {
+    uint64_t messages = 0;
+    uint64_t deltas = 0;
+    uint64_t skipped = 0;           // Deltas before the first keyframe
+    uint64_t bytes = 0;
+    uint64_t objects = 0;
+    uint64_t vertices = 0;
+    int64_t decodeMicros = 0;
+
+    void add(const ReceiveStats& other) {
+        messages += other.messages;
+        deltas += other.deltas;
+        skipped += other.skipped;
+        bytes += other.bytes;
+        objects += other.objects;
+        vertices += other.vertices;
+        decodeMicros += other.decodeMicros;
+    }
+
+    void print(const char* what, double seconds) const {
+        double n = messages > 0 ? (double)messages : 1;
+        printf("%s: %llu messages, %llu of them deltas, %.1f KB/s, %.1f bytes, %.1f objects and %.1f vertices each, decoded in %.2f us\n",
+            what, (unsigned long long)messages, (unsigned long long)deltas, bytes / seconds / 1000, bytes / n, objects / n, vertices / n, decodeMicros / n);
+        if (skipped > 0) printf("  %llu deltas skipped waiting for a keyframe\n", (unsigned long long)skipped);
+    }
+};
+
+static SOCKET listenOn(const char* port) {
+    struct addrinfo hints, * result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_PASSIVE;
+    int iResult = getaddrinfo(NULL, port, &hints, &result);
+    if (iResult != 0) {
+        printf("getaddrinfo failed with error: %d\n", iResult);
+        return INVALID_SOCKET;
+    }
+
+    SOCKET s = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (s != INVALID_SOCKET) {
+        int reuse = 1;
+        setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+        if (bind(s, result->ai_addr, (int)result->ai_addrlen) == SOCKET_ERROR || listen(s, 1) == SOCKET_ERROR) {
+            printf("Can't listen on port %s, error %d\n", port, WSAGetLastError());
+            closesocket(s);
+            s = INVALID_SOCKET;
+        }
+    }
+    else printf("socket failed with error: %d\n", WSAGetLastError());
+    freeaddrinfo(result);
+    return s;
+}
+
+bool receiveBinary(const char* port) {
+    if (netStartup() != 0) return false;
+    SOCKET listener = listenOn(port);
+    if (listener == INVALID_SOCKET) {
+        netCleanup();
+        return false;
+    }
+    printf("Waiting for a sender on port %s\n", port);
+    SOCKET s = accept(listener, NULL, NULL);
+    closesocket(listener);
+    if (s == INVALID_SOCKET) {
+        printf("accept failed with error: %d\n", WSAGetLastError());
+        netCleanup();
+        return false;
+    }
+    printf("Sender connected\n");
+
+    // The last scene decoded and the next, which deltas build on
+    static BinaryScene scenes[2];
+    int current = 0;
+    bool haveScene = false;
+    std::vector<char> buffer(1 << 20);
+    size_t filled = 0;
+    ReceiveStats second, total;
+    int64_t start = steadyMicros();
+    int64_t reported = start;
+    bool ok = true, closed = false;
+    while (ok && !closed) {
+        if (filled == buffer.size()) buffer.resize(buffer.size() * 2);
+        int received = recv(s, buffer.data() + filled, (int)(buffer.size() - filled), 0);
+        if (received <= 0) break;
+        filled += received;
+
+        // Every whole message in the buffer, the rest waits for more
+        size_t used = 0;
+        while (used < filled) {
+            const char* data = buffer.data() + used;
+            size_t size = filled - used;
+            if (size >= 6 && !memcmp(data, "CLOSE\n", 6)) {
+                closed = true;
+                break;
+            }
+            int64_t t0 = steadyMicros();
+            BinaryScene& scene = scenes[!current];
+            int64_t length = readBinaryScene(data, size, haveScene ? &scenes[current] : NULL, scene);
+            if (length == 0) break;
+            if (length == BINARY_NO_BASE) {
+                second.skipped++;
+                used += binaryMessageLength(data, size);
+                continue;
+            }
+            if (length < 0) {
+                printf("Not a binary scene at byte %llu, is the sender running with --binary?\n", (unsigned long long)(total.bytes + second.bytes));
+                ok = false;
+                break;
+            }
+            second.decodeMicros += steadyMicros() - t0;
+            second.messages++;
+            if (scene.flags & BINARY_DELTA) second.deltas++;
+            second.bytes += length;
+            second.objects += scene.geometry.objectCount;
+            second.vertices += scene.geometry.vertexCount;
+            used += length;
+            current = !current;
+            haveScene = true;
+        }
+        memmove(buffer.data(), buffer.data() + used, filled - used);
+        filled -= used;
+
+        int64_t now = steadyMicros();
+        if (now - reported >= 1000000) {
+            second.print("Last second", (now - reported) / 1e6);
+            total.add(second);
+            second = ReceiveStats();
+            reported = now;
+        }
+    }
+    total.add(second);
+    total.print(closed ? "Sender closed" : "Connection lost", (steadyMicros() - start) / 1e6);
+    closesocket(s);
+    netCleanup();
+    return ok;
+}
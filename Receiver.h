@@ -0,0 +1,6 @@
+#pragma once
+
+// Stands in for osci-render when the output is binary: listens on port for one sender, decodes
+// every message it sends with the reference decoder and reports what arrived once a second and
+// in total when the sender closes. False if the socket fails or a message doesn't decode.
+bool receiveBinary(const char* port);
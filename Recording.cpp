@@ -0,0 +1,388 @@
+#include "Recording.h"
+#include "CpuTime.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char recordingMagic[8] = "ORKREC2";
+static const char recordingEnd[8] = "ORKEND";
+
+// Chunks in flight between the capture and writer threads, about a second of 640x480 depth and color
+#define recorderMaxChunks 64
+
+static_assert(sizeof(RecordingChunk) == recordingAlign, "chunk headers keep the payloads aligned");
+static_assert(sizeof(RecordingIndexEntry) == 24, "index entries are written as is");
+
+static uint64_t alignedSize(uint64_t size) {
+    return (size + recordingAlign - 1) & ~(uint64_t)(recordingAlign - 1);
+}
+
+Recorder::Recorder() :
+    file(NULL),
+    chunkCount(0),
+    stopping(false),
+    droppedFrames(0),
+    cpu(0),
+    offset(0) {
+}
+
+Recorder::~Recorder() {
+    close();
+}
+
+bool Recorder::open(const char* path) {
+    file = fopen(path, "wb");
+    if (!file) return false;
+
+    uint8_t header[recordingAlign] = { 0 };
+    memcpy(header, recordingMagic, sizeof(recordingMagic));
+    fwrite(header, 1, sizeof(header), file);
+    offset = sizeof(header);
+    index.reserve(1 << 16);
+
+    stopping = false;
+    droppedFrames = 0;
+    thread = std::thread(&Recorder::run, this);
+    return true;
+}
+
+void Recorder::close() {
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    if (file) {
+        RecordingChunk chunk = {};
+        memcpy(chunk.tag, "INDX", 4);
+        chunk.size = index.size() * sizeof(RecordingIndexEntry);
+        fwrite(&chunk, sizeof(chunk), 1, file);
+        if (!index.empty()) fwrite(index.data(), sizeof(RecordingIndexEntry), index.size(), file);
+
+        uint8_t padding[recordingAlign] = { 0 };
+        fwrite(padding, 1, alignedSize(chunk.size) - chunk.size, file);
+        fwrite(&offset, 8, 1, file);
+        fwrite(recordingEnd, 1, sizeof(recordingEnd), file);
+        fclose(file);
+        if (droppedFrames) printf("Recorder dropped %llu frames\n", (unsigned long long)droppedFrames);
+    }
+    file = NULL;
+
+    for (size_t i = 0; i < spare.size(); i++) delete spare[i];
+    spare.clear();
+    chunkCount = 0;
+    index.clear();
+}
+
+std::vector<uint8_t>* Recorder::beginChunk(uint32_t stream, int64_t timestamp, uint32_t frameNumber, int width, int height, size_t size) {
+    if (!file) return NULL;
+    std::vector<uint8_t>* chunk = NULL;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!spare.empty()) {
+            chunk = spare.back();
+            spare.pop_back();
+        }
+        else if (chunkCount < recorderMaxChunks) {
+            chunk = new std::vector<uint8_t>();
+            chunkCount++;
+        }
+    }
+    if (!chunk) {
+        droppedFrames++;
+        return NULL;
+    }
+
+    size_t total = (size_t)alignedSize(sizeof(RecordingChunk) + size);
+    chunk->resize(total);
+    RecordingChunk* header = (RecordingChunk*)chunk->data();
+    memset(header, 0, sizeof(RecordingChunk));
+    memcpy(header->tag, "FRAM", 4);
+    header->stream = stream;
+    header->size = size;
+    header->timestamp = timestamp;
+    header->frameNumber = frameNumber;
+    header->width = width;
+    header->height = height;
+    memset(chunk->data() + sizeof(RecordingChunk) + size, 0, total - sizeof(RecordingChunk) - size);
+    return chunk;
+}
+
+void Recorder::submit(std::vector<uint8_t>* chunk) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(chunk);
+    }
+    wake.notify_one();
+}
+
+void Recorder::writeDepth(const DepthFrame& frame) {
+    size_t bytes = frame.pixels.size() * sizeof(uint16_t);
+    std::vector<uint8_t>* chunk = beginChunk(STREAM_DEPTH, frame.timestamp, frame.frameNumber, frame.width, frame.height, bytes);
+    if (!chunk) return;
+    memcpy(chunk->data() + sizeof(RecordingChunk), frame.pixels.data(), bytes);
+    submit(chunk);
+}
+
+void Recorder::writeColor(const ColorFrame& frame) {
+    size_t bytes = frame.pixels.size();
+    std::vector<uint8_t>* chunk = beginChunk(STREAM_COLOR, frame.timestamp, frame.frameNumber, frame.width, frame.height, bytes);
+    if (!chunk) return;
+    memcpy(chunk->data() + sizeof(RecordingChunk), frame.pixels.data(), bytes);
+    submit(chunk);
+}
+
+void Recorder::writeSkeleton(const SkeletonFrame& frame) {
+    std::vector<uint8_t>* chunk = beginChunk(STREAM_SKELETON, frame.timestamp, frame.frameNumber, 0, 0, SKELETON_COUNT * sizeof(RecordedBody));
+    if (!chunk) return;
+    RecordedBody* bodies = (RecordedBody*)(chunk->data() + sizeof(RecordingChunk));
+    for (int b = 0; b < SKELETON_COUNT; b++) {
+        const SkeletonBody& body = frame.bodies[b];
+        bodies[b].tracked = body.tracked;
+        bodies[b].trackingId = body.trackingId;
+        for (int i = 0; i < JOINT_COUNT; i++) memcpy(bodies[b].joints[i], &body.joints[i][0], 16);
+        memcpy(bodies[b].jointStates, body.jointStates, JOINT_COUNT);
+    }
+    submit(chunk);
+}
+
+void Recorder::run() {
+    std::vector<std::vector<uint8_t>*> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) break;
+        batch.swap(pending);
+        lock.unlock();
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            const std::vector<uint8_t>& chunk = *batch[i];
+            const RecordingChunk* header = (const RecordingChunk*)chunk.data();
+            RecordingIndexEntry entry = { header->timestamp, offset, header->stream, header->frameNumber };
+            index.push_back(entry);
+            fwrite(chunk.data(), 1, chunk.size(), file);
+            offset += chunk.size();
+        }
+
+        cpu.store(threadCpuMicros(), std::memory_order_relaxed);
+        lock.lock();
+        spare.insert(spare.end(), batch.begin(), batch.end());
+        batch.clear();
+    }
+}
+
+PlaybackSource::PlaybackSource() :
+    data(NULL),
+    size(0),
+    next(0),
+    streams(0),
+    speed(1),
+    loop(false),
+    done(true),
+    firstTimestamp(0) {
+}
+
+PlaybackSource::~PlaybackSource() {
+    close();
+}
+
+// Private copy on write mapping, so frames can hand out writable pointers without touching the file
+bool PlaybackSource::map(const char* path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    // The view keeps the mapping and the file open
+    CloseHandle(file);
+    if (!mapping) return false;
+    data = (uint8_t*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping);
+    size = data ? (size_t)fileSize.QuadPart : 0;
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* p = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            data = (uint8_t*)p;
+            size = info.st_size;
+            madvise(p, size, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+#endif
+    return data != NULL;
+}
+
+bool PlaybackSource::loadIndex() {
+    index.clear();
+
+    // A closed recording ends with the offset of its index chunk
+    if (size >= recordingAlign + 16 && !memcmp(data + size - 8, recordingEnd, sizeof(recordingEnd))) {
+        uint64_t indexOffset;
+        memcpy(&indexOffset, data + size - 16, 8);
+        if (indexOffset >= recordingAlign && indexOffset + sizeof(RecordingChunk) <= size - 16) {
+            const RecordingChunk* chunk = (const RecordingChunk*)(data + indexOffset);
+            uint64_t count = chunk->size / sizeof(RecordingIndexEntry);
+            if (!memcmp(chunk->tag, "INDX", 4) && chunk->size <= size - 16 - indexOffset - sizeof(RecordingChunk)) {
+                const RecordingIndexEntry* entries = (const RecordingIndexEntry*)(chunk + 1);
+                index.assign(entries, entries + count);
+                return true;
+            }
+        }
+    }
+
+    // Otherwise walk the chunks, the last one may have been cut off
+    uint64_t offset = recordingAlign;
+    while (offset + sizeof(RecordingChunk) <= size) {
+        const RecordingChunk* chunk = (const RecordingChunk*)(data + offset);
+        if (memcmp(chunk->tag, "FRAM", 4) || chunk->size > size - offset - sizeof(RecordingChunk)) break;
+        RecordingIndexEntry entry = { chunk->timestamp, offset, chunk->stream, chunk->frameNumber };
+        index.push_back(entry);
+        offset += alignedSize(sizeof(RecordingChunk) + chunk->size);
+    }
+    return true;
+}
+
+bool PlaybackSource::open(const char* path, float speed, bool loop, int streams) {
+    if (!map(path)) return false;
+    if (size < recordingAlign || memcmp(data, recordingMagic, sizeof(recordingMagic)) || !loadIndex() || index.empty()) {
+        close();
+        return false;
+    }
+
+    this->speed = speed;
+    this->loop = loop;
+    this->streams = streams;
+    done = false;
+    seek(0);
+    return true;
+}
+
+void PlaybackSource::close() {
+    if (data) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(data, size);
+#endif
+    }
+    data = NULL;
+    size = 0;
+    index.clear();
+    next = 0;
+    done = true;
+}
+
+void PlaybackSource::restartClock() {
+    firstTimestamp = next < index.size() ? index[next].timestamp : 0;
+    start = std::chrono::steady_clock::now();
+}
+
+void PlaybackSource::seek(int64_t ms) {
+    if (index.empty()) return;
+    // Streams are interleaved in capture order, so the timestamps are close enough to sorted
+    RecordingIndexEntry target = {};
+    target.timestamp = index[0].timestamp + ms;
+    next = std::lower_bound(index.begin(), index.end(), target,
+        [](const RecordingIndexEntry& a, const RecordingIndexEntry& b) { return a.timestamp < b.timestamp; }) - index.begin();
+    if (next >= index.size()) next = index.size() - 1;
+    restartClock();
+}
+
+void PlaybackSource::skipStreams() {
+    while (next < index.size() && !(index[next].stream & streams)) next++;
+}
+
+int PlaybackSource::waitForFrames(int timeoutMs) {
+    skipStreams();
+    if (next >= index.size() && loop && !index.empty()) {
+        // Start over, timing restarts with the first frame
+        next = 0;
+        skipStreams();
+        restartClock();
+    }
+    if (next >= index.size()) {
+        done = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+        return 0;
+    }
+
+    const RecordingIndexEntry& entry = index[next];
+    if (speed > 0) {
+        std::chrono::steady_clock::time_point due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::milli>((entry.timestamp - firstTimestamp) / speed));
+        if (due - std::chrono::steady_clock::now() > std::chrono::milliseconds(timeoutMs)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            return 0;
+        }
+        std::this_thread::sleep_until(due);
+    }
+    return entry.stream;
+}
+
+// The chunk of the next frame if it's from stream, moving past it either way
+const RecordingChunk* PlaybackSource::nextChunk(uint32_t stream) {
+    if (next >= index.size() || index[next].stream != stream) return NULL;
+    uint64_t offset = index[next++].offset;
+    if (offset + sizeof(RecordingChunk) > size) return NULL;
+    const RecordingChunk* chunk = (const RecordingChunk*)(data + offset);
+    if (memcmp(chunk->tag, "FRAM", 4) || chunk->stream != stream || chunk->size > size - offset - sizeof(RecordingChunk)) return NULL;
+    return chunk;
+}
+
+// Image frames keep pointing into the mapping, which outlives the capture thread's buffers
+template <typename Frame>
+static bool readImage(const RecordingChunk* chunk, int bpp, Frame& frame) {
+    if (!chunk || chunk->width <= 0 || chunk->height <= 0 || (uint64_t)chunk->width * chunk->height * bpp != chunk->size) return false;
+    frame.timestamp = chunk->timestamp;
+    frame.frameNumber = chunk->frameNumber;
+    frame.width = chunk->width;
+    frame.height = chunk->height;
+    frame.pixels.wrap((decltype(frame.pixels.data()))(chunk + 1), (size_t)chunk->width * chunk->height * bpp / sizeof(frame.pixels[0]));
+    return true;
+}
+
+bool PlaybackSource::readDepth(DepthFrame& frame) {
+    return readImage(nextChunk(STREAM_DEPTH), 2, frame);
+}
+
+bool PlaybackSource::readColor(ColorFrame& frame) {
+    return readImage(nextChunk(STREAM_COLOR), 4, frame);
+}
+
+void PlaybackSource::skipFrames(int streams) {
+    if (next < index.size() && (index[next].stream & streams)) next++;
+}
+
+bool PlaybackSource::readSkeleton(SkeletonFrame& frame) {
+    const RecordingChunk* chunk = nextChunk(STREAM_SKELETON);
+    if (!chunk || chunk->size != SKELETON_COUNT * sizeof(RecordedBody)) return false;
+    frame.timestamp = chunk->timestamp;
+    frame.frameNumber = chunk->frameNumber;
+    const RecordedBody* bodies = (const RecordedBody*)(chunk + 1);
+    for (int b = 0; b < SKELETON_COUNT; b++) {
+        SkeletonBody& body = frame.bodies[b];
+        body.tracked = bodies[b].tracked != 0;
+        body.trackingId = bodies[b].trackingId;
+        for (int i = 0; i < JOINT_COUNT; i++) memcpy(&body.joints[i][0], bodies[b].joints[i], 16);
+        memcpy(body.jointStates, bodies[b].jointStates, JOINT_COUNT);
+    }
+    return true;
+}
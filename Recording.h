@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FrameSource.h"
+
+// Recorded sensor sessions.
+// File layout, everything little endian and every chunk starting on a 64 byte boundary:
+//   64 byte file header, the magic "ORKREC2" then zeros
+//   one frame chunk per frame: a 64 byte RecordingChunk header, the payload, zero padding
+//   an index chunk listing every frame chunk (RecordingIndexEntry), written on close
+//   16 byte trailer: uint64 offset of the index chunk, then "ORKEND"
+// Image payloads are the raw pixels, 16 bit packed depth or BGRA color.
+// Skeleton payloads are SKELETON_COUNT RecordedBody structs.
+// A file that was never closed has no index, playback rebuilds it by walking the chunks.
+
+#define recordingAlign 64
+
+struct RecordingChunk {
+    char tag[4];            // "FRAM" or "INDX"
+    uint32_t stream;        // STREAM_* of a frame chunk
+    uint64_t size;          // Payload bytes following the header, without the padding
+    int64_t timestamp;
+    uint32_t frameNumber;
+    int32_t width;
+    int32_t height;
+    uint8_t reserved[28];
+};
+
+struct RecordingIndexEntry {
+    int64_t timestamp;
+    uint64_t offset;        // Of the chunk header from the start of the file
+    uint32_t stream;
+    uint32_t frameNumber;
+};
+
+struct RecordedBody {
+    uint8_t tracked;
+    uint8_t reserved[3];
+    uint32_t trackingId;
+    float joints[JOINT_COUNT][4];
+    uint8_t jointStates[JOINT_COUNT];
+};
+
+// Appends frames to a recording from a background thread.
+// The write calls only copy the frame into a pooled chunk buffer, so they are safe to make
+// from the capture thread. Frames are dropped rather than blocking when the disk falls behind.
+class Recorder {
+public:
+    Recorder();
+    ~Recorder();
+
+    bool open(const char* path);
+    // Writes out everything queued, then the index
+    void close();
+
+    void writeDepth(const DepthFrame& frame);
+    void writeColor(const ColorFrame& frame);
+    void writeSkeleton(const SkeletonFrame& frame);
+
+    uint64_t dropped() const { return droppedFrames; }
+
+    // CPU time the writer thread has used so far
+    int64_t cpuMicros() const { return cpu; }
+
+private:
+    // A pooled chunk with its header filled in and room for the payload, NULL to drop the frame
+    std::vector<uint8_t>* beginChunk(uint32_t stream, int64_t timestamp, uint32_t frameNumber, int width, int height, size_t size);
+    void submit(std::vector<uint8_t>* chunk);
+    void run();
+
+    FILE* file;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::vector<uint8_t>*> pending;     // Chunks waiting to be written, in order
+    std::vector<std::vector<uint8_t>*> spare;       // Written chunks, reused so steady state doesn't allocate
+    int chunkCount;
+    bool stopping;
+    std::atomic<uint64_t> droppedFrames;
+    std::atomic<int64_t> cpu;
+
+    // Only touched by the writer thread
+    std::vector<RecordingIndexEntry> index;
+    uint64_t offset;
+};
+
+// Plays a recording back with its original timing, scaled by speed.
+// A speed of 0 hands out frames as fast as they are read.
+// The file is memory mapped and image frames point straight into the mapping, no copies.
+class PlaybackSource : public FrameSource {
+public:
+    PlaybackSource();
+    ~PlaybackSource();
+
+    // Only frames of the streams in the STREAM_* mask are played
+    bool open(const char* path, float speed, bool loop, int streams);
+    void close();
+
+    // Continue from the first frame at least ms after the start of the recording
+    void seek(int64_t ms);
+
+    // True once a non-looping playback has run out of frames
+    bool finished() const { return done; }
+
+    int waitForFrames(int timeoutMs);
+    bool readDepth(DepthFrame& frame);
+    bool readColor(ColorFrame& frame);
+    bool readSkeleton(SkeletonFrame& frame);
+    void skipFrames(int streams);
+
+private:
+    bool map(const char* path);
+    bool loadIndex();
+    const RecordingChunk* nextChunk(uint32_t stream);
+    void skipStreams();
+    void restartClock();
+
+    uint8_t* data;
+    size_t size;
+    std::vector<RecordingIndexEntry> index;
+    size_t next;
+    int streams;
+    float speed;
+    bool loop;
+    bool done;
+    int64_t firstTimestamp;
+    std::chrono::steady_clock::time_point start;
+};
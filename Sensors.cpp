@@ -0,0 +1,138 @@
+#include "Sensors.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SyntheticSource.h"
+
+glm::mat4 sensorTransform(const Sensor& sensor) {
+    glm::mat4 m = glm::translate(glm::mat4(1.0f), sensor.position);
+    return glm::rotate(m, glm::radians(sensor.yaw), glm::vec3(0, 1, 0));
+}
+
+void startSensor(Sensor& sensor, int index, FrameSource* source, const char* recordPath) {
+    sensor.source = source;
+    sensor.capture = new CaptureThread(source, index);
+    if (recordPath) {
+        sensor.recorder = new Recorder();
+        if (sensor.recorder->open(recordPath)) {
+            // The recorder wants everything, whether anything else looks at it or not
+            sensor.capture->record(sensor.recorder);
+            sensor.capture->subscribe(STREAM_DEPTH | STREAM_COLOR | STREAM_SKELETON);
+        }
+        else printf("Unable to record to %s\n", recordPath);
+    }
+    // Frames are picked up by the capture thread as soon as the source signals them
+    sensor.capture->start();
+}
+
+void stopSensor(Sensor& sensor) {
+    if (sensor.capture) sensor.capture->stop();
+    delete sensor.capture;
+    delete sensor.recorder;
+    delete sensor.source;
+    sensor.capture = NULL;
+    sensor.recorder = NULL;
+    sensor.source = NULL;
+}
+
+void mergeSkeletons(const SkeletonFrame* const* frames, const glm::mat4* transforms, int count, SkeletonFrame& merged) {
+    int n = 0;
+    merged.timestamp = 0;
+    merged.frameNumber = 0;
+    merged.captureMicros = 0;
+    for (int s = 0; s < count; s++) {
+        const SkeletonFrame& frame = *frames[s];
+        // The frame number goes with the newest sensor time, sensors count on their own
+        if (s == 0 || frame.timestamp > merged.timestamp) {
+            merged.timestamp = frame.timestamp;
+            merged.frameNumber = frame.frameNumber;
+        }
+        if (frame.captureMicros > merged.captureMicros) merged.captureMicros = frame.captureMicros;
+        for (int b = 0; b < SKELETON_COUNT && n < SKELETON_COUNT; b++) {
+            const SkeletonBody& body = frame.bodies[b];
+            if (!body.tracked) continue;
+            SkeletonBody& out = merged.bodies[n++];
+            out = body;
+            for (int i = 0; i < JOINT_COUNT; i++) {
+                // w stays as the sensor reported it
+                glm::vec4 p = transforms[s] * glm::vec4(glm::vec3(body.joints[i]), 1.0f);
+                out.joints[i] = glm::vec4(glm::vec3(p), body.joints[i].w);
+            }
+        }
+    }
+    for (; n < SKELETON_COUNT; n++) merged.bodies[n].tracked = false;
+}
+
+bool benchSensors(int sensors, int bodies) {
+    if (sensors > MAX_SENSORS) sensors = MAX_SENSORS;
+    printf("%u hardware threads, %d bodies per sensor\n", std::thread::hardware_concurrency(), bodies);
+    printf("%-8s %12s %14s %10s\n", "sensors", "frames/s", "per sensor", "scaling");
+
+    bool ok = true;
+    double single = 0;
+    for (int n = 1; n <= sensors; n++) {
+        std::vector<Sensor> rig(n);
+        for (int s = 0; s < n; s++) {
+            startSensor(rig[s], s, new SyntheticSource(bodies, 0, StreamSettings()), NULL);
+            rig[s].capture->subscribe(STREAM_DEPTH | STREAM_COLOR | STREAM_SKELETON);
+        }
+
+        // Consume like the main loop does, checking the tags on the way
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (std::chrono::steady_clock::now() < end) {
+            for (int s = 0; s < n; s++) {
+                if (!rig[s].capture->skeleton.update()) continue;
+                const SkeletonFrame& frame = rig[s].capture->skeleton.readBuffer();
+                if (frame.sensor != s || frame.bodies[0].sensor != s) ok = false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        uint64_t frames = 0;
+        for (int s = 0; s < n; s++) {
+            rig[s].capture->stop();
+            rig[s].capture->skeleton.update();
+            frames += rig[s].capture->skeleton.readBuffer().sequence;
+        }
+
+        // Same poses from every sensor, each placed a meter further along x and turned around
+        if (bodies > 0) {
+            const SkeletonFrame* frames[MAX_SENSORS];
+            glm::mat4 transforms[MAX_SENSORS];
+            for (int s = 0; s < n; s++) {
+                rig[s].position = glm::vec3((float)s, 0, 0);
+                rig[s].yaw = s * 90.0f;
+                frames[s] = &rig[0].capture->skeleton.readBuffer();
+                transforms[s] = sensorTransform(rig[s]);
+            }
+            static SkeletonFrame merged;
+            mergeSkeletons(frames, transforms, n, merged);
+            int expected = n * bodies < SKELETON_COUNT ? n * bodies : SKELETON_COUNT;
+            for (int b = 0; b < expected; b++) {
+                const SkeletonBody& body = merged.bodies[b];
+                int s = b / bodies;
+                const SkeletonBody* source = &frames[0]->bodies[0];
+                for (int i = 0; i < SKELETON_COUNT; i++)
+                    if (frames[0]->bodies[i].tracked && frames[0]->bodies[i].trackingId == body.trackingId) source = &frames[0]->bodies[i];
+                glm::vec4 p = source->joints[JOINT_HEAD];
+                float a = glm::radians(s * 90.0f);
+                glm::vec3 want = glm::vec3(s + p.x * cosf(a) + p.z * sinf(a), p.y, -p.x * sinf(a) + p.z * cosf(a));
+                if (!body.tracked || glm::length(glm::vec3(body.joints[JOINT_HEAD]) - want) > 1e-4f) ok = false;
+            }
+            if (expected < SKELETON_COUNT && merged.bodies[expected].tracked) ok = false;
+        }
+        for (int s = 0; s < n; s++) stopSensor(rig[s]);
+
+        double rate = (double)frames;
+        if (n == 1) single = rate;
+        printf("%-8d %12.1f %14.1f %9.2fx\n", n, rate, rate / n, single > 0 ? rate / single : 0);
+    }
+    printf("Sensor tags and merge %s\n", ok ? "ok" : "MISMATCH");
+    return ok;
+}
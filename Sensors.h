@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include "Capture.h"
+#include "FrameSource.h"
+#include "Recording.h"
+
+// One capture pipeline per attached sensor: its source, capture thread, frame buffers and
+// recorder, plus where it stands so its skeletons can be mapped into one shared output space.
+// The shared space has the axes of Kinect skeleton space, as seen by a sensor at the origin.
+
+#define MAX_SENSORS 8
+
+struct Sensor {
+    FrameSource* source = NULL;
+    CaptureThread* capture = NULL;
+    Recorder* recorder = NULL;
+    glm::vec3 position = glm::vec3(0);  // Meters
+    float yaw = 0;                      // Degrees around the vertical axis
+};
+
+// Sensor space to shared space
+glm::mat4 sensorTransform(const Sensor& sensor);
+
+// Takes ownership of the source and starts its capture thread, recording to recordPath if not NULL.
+// Nothing but the recorder reads the streams until consumers subscribe() to them.
+void startSensor(Sensor& sensor, int index, FrameSource* source, const char* recordPath);
+void stopSensor(Sensor& sensor);
+
+// Maps the tracked bodies of every frame into the shared space and packs the first
+// SKELETON_COUNT of them into merged. Each body keeps the index of the sensor it came from.
+// merged gets the newest sensor time with that frame's number, and the latest capture time.
+void mergeSkeletons(const SkeletonFrame* const* frames, const glm::mat4* transforms, int count, SkeletonFrame& merged);
+
+// Runs 1 to sensors unpaced synthetic sensors for a second each and reports the frame rate
+// to show how capture scales with cores. Also checks that frames keep their sensor tags and
+// that merging places each sensor's bodies by its transform. Returns false if not.
+bool benchSensors(int sensors, int bodies);
@@ -0,0 +1,127 @@
+#include "Skeletons.h"
+
+#include <string.h>
+
+static int findBody(const SkeletonFrame& frame, int sensor, uint32_t trackingId) {
+    for (int s = 0; s < SKELETON_COUNT; s++) {
+        const SkeletonBody& body = frame.bodies[s];
+        if (body.tracked && body.sensor == sensor && body.trackingId == trackingId) return s;
+    }
+    return -1;
+}
+
+static int freeLabel(const BodyStore& store, int count) {
+    for (int label = 1; label <= SKELETON_COUNT; label++) {
+        bool used = false;
+        for (int b = 0; b < count && !used; b++) used = store.label[b] == label;
+        if (!used) return label;
+    }
+    return 0;
+}
+
+static void copyJoints(BodyStore& store, int b, const SkeletonBody& body) {
+    uint32_t found = 0;
+    for (int i = 0; i < JOINT_COUNT; i++) {
+        store.x[b][i] = body.joints[i].x;
+        store.y[b][i] = body.joints[i].y;
+        store.z[b][i] = body.joints[i].z;
+        store.state[b][i] = body.jointStates[i];
+        found |= (uint32_t)(body.jointStates[i] != JOINT_NOT_TRACKED) << i;
+    }
+    store.found[b] = found;
+}
+
+void updateBodies(BodyStore& store, const SkeletonFrame& frame) {
+    bool known[SKELETON_COUNT] = { false };
+    int n = 0;
+    for (int b = 0; b < store.count; b++) {
+        int s = findBody(frame, store.sensor[b], store.trackingId[b]);
+        if (s < 0) continue;
+        known[s] = true;
+        store.previous[n] = b;
+        store.label[n] = store.label[b];
+        store.sensor[n] = store.sensor[b];
+        store.trackingId[n] = store.trackingId[b];
+        copyJoints(store, n, frame.bodies[s]);
+        n++;
+    }
+    for (int s = 0; s < SKELETON_COUNT && n < SKELETON_COUNT; s++) {
+        const SkeletonBody& body = frame.bodies[s];
+        if (!body.tracked || known[s]) continue;
+        store.previous[n] = -1;
+        store.label[n] = freeLabel(store, n);
+        store.sensor[n] = body.sensor;
+        store.trackingId[n] = body.trackingId;
+        copyJoints(store, n, body);
+        n++;
+    }
+    store.count = n;
+    store.timestamp = frame.timestamp;
+    store.frameNumber = frame.frameNumber;
+    store.captureMicros = frame.captureMicros;
+}
+
+void followBodies(const BodyStore& store, int lastCount, int* frames, float (*const* state)[JOINT_COUNT], int stateCount) {
+    // Bodies only ever move down, copying in order never overwrites one still to be moved
+    for (int b = 0; b < store.count; b++) {
+        int p = store.previous[b];
+        if (p < 0 || p >= lastCount) frames[b] = 0;
+        else if (p != b) {
+            frames[b] = frames[p];
+            for (int k = 0; k < stateCount; k++) memcpy(state[k][b], state[k][p], sizeof(state[k][b]));
+        }
+    }
+}
+
+void BodyTrack::reset(int frames) {
+    this->frames = frames;
+    position.assign((size_t)frames * SKELETON_COUNT * JOINT_COUNT, glm::vec3(0));
+    valid.assign((size_t)frames * SKELETON_COUNT * JOINT_COUNT, 0);
+}
+
+void BodyTrack::record(int frame, const BodyStore& store) {
+    for (int b = 0; b < store.count; b++) {
+        for (int i = 0; i < JOINT_COUNT; i++) {
+            size_t t = index(frame, store.label[b] - 1, i);
+            position[t] = glm::vec3(store.x[b][i], store.y[b][i], store.z[b][i]);
+            // A body that just showed up breaks the run, as if it wasn't there the frame before
+            valid[t] = store.state[b][i] == JOINT_TRACKED ? (store.previous[b] < 0 ? 1 : 2) : 0;
+        }
+    }
+}
+
+bool BodyTrack::continuous(int first, int last, int label, int joint) const {
+    if (first < 0 || last >= frames) return false;
+    if (!valid[index(first, label, joint)]) return false;
+    for (int f = first + 1; f <= last; f++) if (valid[index(f, label, joint)] != 2) return false;
+    return true;
+}
+
+void readSkeletonFrames(FrameSource* source, int frames, std::vector<SkeletonFrame>& out) {
+    out.reserve(frames);
+    static SkeletonFrame skeleton;
+    int idle = 0;
+    while ((int)out.size() < frames) {
+        int ready = source->waitForFrames(100);
+        if (!ready && ++idle > 10) break;
+        if (ready & (STREAM_DEPTH | STREAM_COLOR)) source->skipFrames(ready & (STREAM_DEPTH | STREAM_COLOR));
+        if (!(ready & STREAM_SKELETON) || !source->readSkeleton(skeleton)) continue;
+        idle = 0;
+        out.push_back(skeleton);
+    }
+}
+
+void addJointNoise(std::vector<SkeletonFrame>& frames, float mm) {
+    if (mm <= 0) return;
+    uint32_t seed = 12345;
+    for (SkeletonFrame& frame : frames) {
+        for (int b = 0; b < SKELETON_COUNT; b++) {
+            for (int i = 0; i < JOINT_COUNT; i++) {
+                for (int c = 0; c < 3; c++) {
+                    seed = seed * 1664525 + 1013904223;
+                    frame.bodies[b].joints[i][c] += ((seed >> 8) / 16777216.0f * 2 - 1) * mm / 1000;
+                }
+            }
+        }
+    }
+}
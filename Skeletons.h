@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "Frames.h"
+#include "FrameSource.h"
+
+// The tracked bodies of the merged skeleton frame, compacted to the front and stored as one
+// array per joint component, so everything after it only loops over the active ones.
+// A body is known by its sensor and tracking ID. It keeps its place in the store and its label
+// for as long as it stays tracked, wherever the runtime moves it among the skeleton slots.
+struct BodyStore {
+    // The skeleton frame of the last update
+    int64_t timestamp = 0;                  // Sensor milliseconds
+    uint32_t frameNumber = 0;
+    int64_t captureMicros = 0;              // steadyMicros() when the capture thread read it
+
+    int count = 0;                          // Bodies [0, count) are active
+    int label[SKELETON_COUNT];              // 1 based, the smallest one free when the body showed up
+    int sensor[SKELETON_COUNT];
+    uint32_t trackingId[SKELETON_COUNT];
+    int previous[SKELETON_COUNT];           // Index before the last update, -1 if new, so per body state kept elsewhere can follow
+    uint32_t found[SKELETON_COUNT];         // Bit i set if joint i is tracked or inferred
+    alignas(64) float x[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float y[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) float z[SKELETON_COUNT][JOINT_COUNT];
+    alignas(64) uint8_t state[SKELETON_COUNT][JOINT_COUNT];    // JointState
+};
+
+// Updates known bodies in place, drops the ones that are gone without reordering the rest
+// and appends new ones
+void updateBodies(BodyStore& store, const SkeletonFrame& frame);
+
+// Moves per body state kept in [SKELETON_COUNT][JOINT_COUNT] arrays along with the store's last
+// update. lastCount is how many bodies the state was for, frames[] counts the updates each body
+// has had and starts new ones at 0.
+void followBodies(const BodyStore& store, int lastCount, int* frames, float (*const* state)[JOINT_COUNT], int stateCount);
+
+// Positions of every label's joints over a whole run, for the offline harnesses
+struct BodyTrack {
+    int frames = 0;
+    std::vector<glm::vec3> position;    // [frame][label - 1][joint]
+    std::vector<uint8_t> valid;         // 0 not tracked, 1 first frame of a body, 2 tracked since the frame before
+
+    void reset(int frames);
+    // Tracked joints of every active body
+    void record(int frame, const BodyStore& store);
+    size_t index(int frame, int label, int joint) const { return ((size_t)frame * SKELETON_COUNT + label) * JOINT_COUNT + joint; }
+    // Whether the joint was tracked from first to last without a break, label is 0 based
+    bool continuous(int first, int last, int label, int joint) const;
+};
+
+// Reads up to frames skeleton frames as fast as the source gives them, skipping everything else
+void readSkeletonFrames(FrameSource* source, int frames, std::vector<SkeletonFrame>& out);
+
+// Adds up to mm of uniform noise to every joint, the same noise on every call
+void addJointNoise(std::vector<SkeletonFrame>& frames, float mm);
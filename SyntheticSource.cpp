@@ -0,0 +1,190 @@
+#include "SyntheticSource.h"
+
+#include <math.h>
+#include <thread>
+
+// NUI_CAMERA_DEPTH_NOMINAL_FOCAL_LENGTH_IN_PIXELS is given for 320x240
+#define nominalFocal 285.63f
+
+#define jointRadius 0.08f
+#define backgroundDepth 3500
+// Frames between moving every body one skeleton slot along
+#define slotPeriod 300
+
+SyntheticSource::SyntheticSource(int bodies, float fps, const StreamSettings& streams) :
+    bodies(bodies < 0 ? 0 : bodies > SKELETON_COUNT ? SKELETON_COUNT : bodies),
+    depthWidth(resolutionWidth(streams.depth)),
+    depthHeight(resolutionHeight(streams.depth)),
+    colorWidth(resolutionWidth(streams.color)),
+    colorHeight(resolutionHeight(streams.color)),
+    focal(nominalFocal * resolutionWidth(streams.depth) / 320),
+    interval(fps > 0 ? (int64_t)(1e9 / fps) : 0),
+    nextFrame(std::chrono::steady_clock::now()),
+    frameNumber(0),
+    colorFrameNumber(0),
+    timestamp(0),
+    pending(0) {
+}
+
+int SyntheticSource::waitForFrames(int timeoutMs) {
+    if (pending) return pending;
+
+    if (interval.count() > 0) {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (nextFrame - now > std::chrono::milliseconds(timeoutMs)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs));
+            return 0;
+        }
+        std::this_thread::sleep_until(nextFrame);
+        nextFrame += interval;
+        // Don't try to catch up after a stall, just carry on from now
+        if (nextFrame < now) nextFrame = now + interval;
+    }
+
+    // Sensor time advances at the nominal rate even when frames are produced unpaced
+    frameNumber++;
+    timestamp = interval.count() > 0 ? frameNumber * interval.count() / 1000000 : frameNumber * 1000 / 30;
+
+    skeletons.timestamp = timestamp;
+    skeletons.frameNumber = frameNumber;
+    for (int s = 0; s < SKELETON_COUNT; s++) {
+        skeletons.bodies[s].tracked = false;
+        skeletons.bodies[s].trackingId = 0;
+    }
+    // Like the runtime, bodies are moved to other slots now and then but keep their tracking ID
+    for (int b = 0; b < bodies; b++) {
+        SkeletonBody& body = skeletons.bodies[(b + frameNumber / slotPeriod) % SKELETON_COUNT];
+        body.tracked = true;
+        body.trackingId = b + 1;
+        poseBody(b, timestamp / 1000.f, body);
+    }
+
+    pending = STREAM_SKELETON;
+    if (depthWidth) pending |= STREAM_DEPTH;
+    // High resolution color runs at 12 fps, 2 of every 5 frames
+    if (colorWidth && (colorWidth < 1280 || frameNumber % 5 < 2)) {
+        pending |= STREAM_COLOR;
+        colorFrameNumber++;
+    }
+    return pending;
+}
+
+void SyntheticSource::poseBody(int b, float t, SkeletonBody& body) {
+    const float pi = 3.14159265f;
+    float phase = t * 2.f + b * 1.3f;
+    glm::vec3 root = {
+        (b - (bodies - 1) * 0.5f) * 0.8f + 0.3f * sinf(t * 0.5f + b),
+        0.f,
+        2.5f + 0.4f * sinf(t * 0.3f + b * 2.f) };
+
+    glm::vec3 p[JOINT_COUNT];
+    p[JOINT_HIP_CENTER] = { 0.f, 0.f, 0.f };
+    p[JOINT_SPINE] = { 0.f, 0.1f, 0.f };
+    p[JOINT_SHOULDER_CENTER] = { 0.f, 0.45f, 0.f };
+    p[JOINT_HEAD] = { 0.f, 0.65f, 0.f };
+
+    for (int side = 0; side < 2; side++) {
+        float s = side == 0 ? -1.f : 1.f;
+        int shoulder = side == 0 ? JOINT_SHOULDER_LEFT : JOINT_SHOULDER_RIGHT;
+        int hip = side == 0 ? JOINT_HIP_LEFT : JOINT_HIP_RIGHT;
+
+        // Arms wave between raised and hanging, the forearm bent upwards
+        float a = 0.4f + 0.9f * sinf(phase + side * pi);
+        float a2 = a - 0.6f;
+        glm::vec3 upper = { s * cosf(a), -sinf(a), 0.f };
+        glm::vec3 fore = { s * cosf(a2), -sinf(a2), 0.f };
+        p[shoulder] = { s * 0.18f, 0.4f, 0.f };
+        p[shoulder + 1] = p[shoulder] + upper * 0.28f;
+        p[shoulder + 2] = p[shoulder + 1] + fore * 0.25f;
+        p[shoulder + 3] = p[shoulder + 2] + fore * 0.08f;
+
+        // Legs step forwards and back
+        float l = 0.35f * sinf(phase + side * pi);
+        p[hip] = { s * 0.1f, -0.05f, 0.f };
+        p[hip + 1] = p[hip] + glm::vec3(0.f, -cosf(l), -sinf(l)) * 0.4f;
+        p[hip + 2] = p[hip + 1] + glm::vec3(0.f, -0.4f, 0.f);
+        p[hip + 3] = p[hip + 2] + glm::vec3(0.f, -0.05f, -0.1f);
+    }
+
+    for (int i = 0; i < JOINT_COUNT; i++) {
+        body.joints[i] = glm::vec4(root + p[i], 1.f);
+        body.jointStates[i] = JOINT_TRACKED;
+    }
+}
+
+bool SyntheticSource::readDepth(DepthFrame& frame) {
+    if (!(pending & STREAM_DEPTH)) return false;
+    pending &= ~STREAM_DEPTH;
+
+    frame.timestamp = timestamp;
+    frame.frameNumber = frameNumber;
+    const int w = depthWidth, h = depthHeight;
+    frame.width = w;
+    frame.height = h;
+    frame.pixels.resize(w * h);
+
+    // Back wall, getting closer towards the floor
+    for (int y = 0; y < h; y++) {
+        uint16_t depth = (uint16_t)(backgroundDepth - (y > h / 2 ? (y - h / 2) * 1920 / h : 0));
+        uint16_t* row = frame.pixels.data() + y * w;
+        for (int x = 0; x < w; x++) row[x] = depth << 3;
+    }
+
+    // A disc per joint, tagged with the player index
+    for (int b = 0; b < SKELETON_COUNT; b++) {
+        const SkeletonBody& body = skeletons.bodies[b];
+        if (!body.tracked) continue;
+        for (int i = 0; i < JOINT_COUNT; i++) {
+            const glm::vec4& j = body.joints[i];
+            if (j.z <= 0.f) continue;
+            int cx = (int)(w / 2 + j.x / j.z * focal);
+            int cy = (int)(h / 2 - j.y / j.z * focal);
+            int r = (int)(jointRadius / j.z * focal);
+            uint16_t packed = (uint16_t)(((int)(j.z * 1000) << 3) | (b + 1));
+            for (int y = cy - r; y <= cy + r; y++) {
+                if (y < 0 || y >= h) continue;
+                for (int x = cx - r; x <= cx + r; x++) {
+                    if (x < 0 || x >= w) continue;
+                    if ((x - cx) * (x - cx) + (y - cy) * (y - cy) > r * r) continue;
+                    uint16_t& pixel = frame.pixels[y * w + x];
+                    if (packed < pixel) pixel = packed;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool SyntheticSource::readColor(ColorFrame& frame) {
+    if (!(pending & STREAM_COLOR)) return false;
+    pending &= ~STREAM_COLOR;
+
+    frame.timestamp = timestamp;
+    frame.frameNumber = colorFrameNumber;
+    frame.width = colorWidth;
+    frame.height = colorHeight;
+    frame.pixels.resize(colorWidth * colorHeight * 4);
+
+    uint8_t* dest = frame.pixels.data();
+    for (int y = 0; y < colorHeight; y++) {
+        for (int x = 0; x < colorWidth; x++) {
+            *dest++ = (uint8_t)(x + frameNumber * 4);
+            *dest++ = (uint8_t)(y + frameNumber * 2);
+            *dest++ = 0x80;
+            *dest++ = 0xff;
+        }
+    }
+    return true;
+}
+
+bool SyntheticSource::readSkeleton(SkeletonFrame& frame) {
+    if (!(pending & STREAM_SKELETON)) return false;
+    pending &= ~STREAM_SKELETON;
+    frame = skeletons;
+    return true;
+}
+
+void SyntheticSource::skipFrames(int streams) {
+    // Frames are only generated when read, skipping them costs nothing
+    pending &= ~streams;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+
+#include "FrameSource.h"
+
+// Procedural frame source: walking, waving skeletons with matching depth blobs and a scrolling color pattern.
+// Needs no hardware, so the whole pipeline can run and be profiled on any machine.
+class SyntheticSource : public FrameSource {
+public:
+    // fps <= 0 produces frames as fast as they are read
+    SyntheticSource(int bodies, float fps, const StreamSettings& streams);
+
+    int waitForFrames(int timeoutMs);
+    bool readDepth(DepthFrame& frame);
+    bool readColor(ColorFrame& frame);
+    bool readSkeleton(SkeletonFrame& frame);
+    void skipFrames(int streams);
+
+private:
+    void poseBody(int b, float t, SkeletonBody& body);
+
+    int bodies;
+    int depthWidth, depthHeight;
+    int colorWidth, colorHeight;
+    float focal;
+    std::chrono::nanoseconds interval;
+    std::chrono::steady_clock::time_point nextFrame;
+    uint32_t frameNumber;
+    uint32_t colorFrameNumber;  // High resolution color skips frames, its numbers count only its own
+    int64_t timestamp;
+    int pending;        // Streams of the current frame that have not been read yet
+    SkeletonFrame skeletons;
+};
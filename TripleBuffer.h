@@ -0,0 +1,38 @@
+#pragma once
+
+// Lock-free triple buffer for handing frames from one producer thread to one consumer thread.
+// The producer always owns a buffer to write into and the consumer always owns a buffer to read,
+// so neither side ever blocks; the consumer just picks up the newest published frame.
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : back(0), middle(1), front(2) {}
+
+    // Producer side: fill writeBuffer(), then publish() it
+    T& writeBuffer() { return buffers[back]; }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer side: update() swaps in the newest frame, returns false if nothing new was published
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    const T& readBuffer() const { return buffers[front]; }
+
+private:
+    static const int INDEX = 3;
+    static const int FRESH = 4;
+
+    T buffers[3];
+    alignas(64) int back;
+    alignas(64) std::atomic<int> middle;
+    alignas(64) int front;
+};
@@ -11,24 +11,50 @@
 #include "imgui_impl_sdl3.h"
 #include "imgui_impl_opengl3.h"
 #include <stdio.h>
-#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <vector>
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_opengl.h>
 
-
-#include <Windows.h>
-#include <Ole2.h>
-#include <NuiApi.h>
-
 #include <glm/glm.hpp>
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include "Net.h"
 #include "json.hpp"
 
+#include "Frames.h"
+#include "Capture.h"
+#include "Bones.h"
+#include "Checks.h"
+#include "CpuTime.h"
+#include "DepthColor.h"
+#include "DepthShader.h"
+#include "Geometry.h"
+#include "Interpolation.h"
+#include "JointFilter.h"
+#include "OsciBinary.h"
+#include "OsciJson.h"
+#include "Pipeline.h"
+#include "Prediction.h"
+#include "Primitives.h"
+#include "Receiver.h"
+#include "Recording.h"
+#include "Sensors.h"
+#include "Skeletons.h"
+#include "SyntheticSource.h"
+#ifdef _WIN32
+#include "KinectSource.h"
+#endif
+
 using json = nlohmann::json;
-json skeletonJson;
-bool skeletonJsonChanged = false;
+// This frame's output geometry and the last one's, to only send what changed
+FrameGeometry geometryFrames[2];
+int geometryFrame = 0;
+bool geometryChanged = false;
 
 bool headCube = true;
 bool headIco = true;
@@ -47,27 +73,128 @@ glm::vec3 handCubeRotationR = { 0,0,0 };
 glm::vec3 footCubeRotationL = { 0,0,0 };
 glm::vec3 footCubeRotationR = { 0,0,0 };
 
-WSADATA wsaData = { 0 };
+float headCSpeedX = 3.21;
+float headCSpeedY = 3.21;
+float headCSpeedZ = 3.21;
+
+float headISpeedX = -3.21/2;
+float headISpeedY = -3.21/2;
+float headISpeedZ = -3.21/2;
+
+float handCSpeedX = 2.13;
+float handCSpeedY = 2.13;
+float handCSpeedZ = 2.13;
+
+float footCSpeedX = 2.23;
+float footCSpeedY = 2.23;
+float footCSpeedZ = 2.23;
+
 SOCKET orsock = INVALID_SOCKET;
 
+// Size of the depth and color viewports
 #define camW 640
 #define camH 480
 
+// The textures follow the size of the frames that arrive, 0 until the first one
 GLuint texIDD;
 GLuint texIDC;
-GLubyte dataD[camW * camH * 4];
-GLubyte dataC[camW * camH * 4];
-
-HANDLE rgbStream;
-HANDLE depthStream;
-INuiSensor* sensor;
+GLuint texIDDRaw;
+int depthW = 0, depthH = 0;
+int colorW = 0, colorH = 0;
+std::vector<GLubyte> dataD;
+DepthColorSettings depthColor;
+
+// Colorize depth in a shader from the raw frame instead of converting it on the CPU
+bool depthShaderReady = false;
+bool gpuDepth = false;
+
+// Latest frames of the sensor being viewed, uploaded straight from the capture buffers.
+// They stay ours until the next update(). The sequence of what's in the textures lets unchanged frames be skipped.
+int viewSensor = 0;
+int shownSensor = 0;
+const DepthFrame* depthFrame = NULL;
+const ColorFrame* colorFrame = NULL;
+uint64_t depthUploaded = 0;
+bool depthUploadedGpu = false;
+uint64_t colorUploaded = 0;
+
+// Command line options
+StreamSettings streams;
+int syntheticBodies = -1;
+int syntheticSensors = 1;
+float syntheticFps = 30;
+const char* playbackPath = NULL;
+float playbackSpeed = 1;
+bool playbackLoop = false;
+float playbackSeek = 0;
+const char* recordPath = NULL;
+bool benchDepth = false;
+int benchReplayFrames = 0;
+int benchSensorCount = 0;
+int benchBodyFrames = 0;
+int benchFilterFrames = 0;
+int benchPredictFrames = 0;
+int benchPrimitiveFrames = 0;
+int checkAllocationFrames = 0;
+int benchJsonFrames = 0;
+int benchBinaryFrames = 0;
+int checkDeltaFrames = 0;
+int benchGridFrames = 0;
+bool receive = false;
+bool checkGpuDepth = false;
+bool headless = false;
+float outputRate = 0;           // Hz, 0 to follow the skeleton frames headless and send every 4th window frame
+
+Sensor sensors[MAX_SENSORS];
+int sensorCount = 0;
+SkeletonFrame mergedSkeleton;
+
+// Streams the views are subscribed to, on which sensor
+int renderSensor = -1;
+int renderStreams = 0;
+
+// CPU time per stage, reported as the share of one core over the last second
+enum Stage { STAGE_CAPTURE = 0, STAGE_RECORD, STAGE_INGEST, STAGE_OUTPUT, STAGE_RENDER, STAGE_COUNT };
+const char* stageNames[STAGE_COUNT] = { "capture", "record", "ingest", "output", "render" };
+int64_t stageCpu[STAGE_COUNT];
+int64_t stageCpuReported[STAGE_COUNT];
+float stageLoad[STAGE_COUNT];
+std::chrono::steady_clock::time_point stageReportTime = std::chrono::steady_clock::now();
 
 int activeSkeletons = 0;
-Vector4 skeletonPosition[NUI_SKELETON_POSITION_COUNT];
-Vector4 skeletonPosition2[NUI_SKELETON_POSITION_COUNT];
+BodyStore bodies;
+BoneStrokes boneStrokes;        // Of the bodies, for the preview and the output
+MeshBatch primitives;           // Of the output bodies
+JointFilterSettings jointFilterSettings;
+JointFilter jointFilter;
+int64_t lastSkeletonTimestamp = 0;
+int64_t lastSkeletonCapture = 0;
+PredictionSettings prediction;
+JointHistory history;          // Of the filtered bodies
+JointPredictor predictor;
+BodyStore predictedBodies;
+InterpolationMode interpolation = INTERPOLATE_NONE;
+BodyStore interpolatedBodies;
+float outputLatencyMs = 0;      // From the capture thread reading the skeleton to building the output
+float predictionMs = 0;
+bool sendFrameInfo = false;     // Skeleton frame number, sensor time and latency in the JSON too
+float gridMm = 0.5f;            // Output vertices snap to this grid, 0 for none
+bool binaryOutput = false;      // The binary framing instead of JSON, for receivers that read it
+BinaryPrecision binaryPrecision = BINARY_FLOAT32;
+DeltaEncoder binaryEncoder;
+int keyframeInterval = 1;       // Binary messages per keyframe, 1 to send no deltas
+
+// Frames the output never saw, per stream: gaps in the sensors' frame numbers are counted by the
+// capture threads, gaps in the capture sequence are frames overwritten before ingest took them
+uint64_t readSequence[MAX_SENSORS][3];
+unsigned long long unreadFrames[3];
+
+// Preview colors by body label
+const glm::vec3 bodyColors[SKELETON_COUNT] = { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 1 }, { 1, 0, 1 } };
 
 void SDLCleanup(SDL_GLContext gl_context, SDL_Window* window) {
     // Cleanup
+    destroyDepthShader();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
@@ -77,184 +204,280 @@ void SDLCleanup(SDL_GLContext gl_context, SDL_Window* window) {
     SDL_Quit();
 }
 
-bool initKinect() {
-    // Get a working kinect sensor
-    int numSensors = 0;
-    if (NuiGetSensorCount(&numSensors) < 0 || numSensors < 1) return false;
-    if (NuiCreateSensorByIndex(0, &sensor) < 0) return false;
-
-    // Initialize sensor
-    sensor->NuiInitialize(NUI_INITIALIZE_FLAG_USES_DEPTH | NUI_INITIALIZE_FLAG_USES_COLOR | NUI_INITIALIZE_FLAG_USES_SKELETON);
-
-    sensor->NuiSkeletonTrackingEnable(
-        NULL,
-        0     // NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT for only upper body
-    );
-
-    sensor->NuiImageStreamOpen(
-        NUI_IMAGE_TYPE_DEPTH,
-        NUI_IMAGE_RESOLUTION_640x480,    // Image resolution
-        0,      // Image stream flags, e.g. near mode
-        2,      // Number of frames to buffer
-        NULL,   // Event handle
-        &depthStream);
-    sensor->NuiImageStreamOpen(
-        NUI_IMAGE_TYPE_COLOR,                     // Depth camera or rgb camera?
-        NUI_IMAGE_RESOLUTION_640x480,             // Image resolution
-        0,      // Image stream flags, e.g. near mode
-        2,      // Number of frames to buffer
-        NULL,   // Event handle
-        &rgbStream);
-    return sensor;
-}
-
-void getSkeletonData() {
-    NUI_SKELETON_FRAME sF = { 0 };
-    if (sensor->NuiSkeletonGetNextFrame(0, &sF) >= 0) {
-        sensor->NuiTransformSmooth(&sF, NULL);
-        activeSkeletons = 0;
-        int sk = NUI_SKELETON_COUNT;
-        if (sk > 0) {
-            int z = 0;
-            const NUI_SKELETON_DATA& skeleton = sF.SkeletonData[z];
-            if (skeleton.eTrackingState == NUI_SKELETON_TRACKED) {
-                for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++) {
-                    skeletonPosition[i] = skeleton.SkeletonPositions[i];
-                    skeletonPosition[i].z = skeletonPosition[i].z + slide;
-                    if (skeleton.eSkeletonPositionTrackingState[i] == NUI_SKELETON_POSITION_NOT_TRACKED) {
-                        skeletonPosition[i].w = -1;
-                    }
-                    else skeletonPosition[i].w = 1;
-                }
-                activeSkeletons++;
-            }
-        }
-        if (sk > 1) {
-            int z = 1;
-            const NUI_SKELETON_DATA& skeleton = sF.SkeletonData[z];
-            if (skeleton.eTrackingState == NUI_SKELETON_TRACKED) {
-                for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++) {
-                    skeletonPosition2[i] = skeleton.SkeletonPositions[i];
-                    skeletonPosition2[i].z = skeletonPosition2[i].z + slide;
-                    if (skeleton.eSkeletonPositionTrackingState[i] == NUI_SKELETON_POSITION_NOT_TRACKED) {
-                        skeletonPosition2[i].w = -1;
-                    }
-                    else skeletonPosition2[i].w = 1;
-                }
-                activeSkeletons++;
-            }
+int kinectSensorCount() {
+#ifdef _WIN32
+    return KinectSource::sensorCount();
+#else
+    return 0;
+#endif
+}
+
+FrameSource* openKinect(int index) {
+#ifdef _WIN32
+    KinectSource* kinect = new KinectSource();
+    if (!kinect->open(index, streams)) {
+        delete kinect;
+        return NULL;
+    }
+    return kinect;
+#else
+    (void)index;
+    return NULL;
+#endif
+}
+
+// Source for sensor index, NULL if it can't be opened
+FrameSource* openSource(int index) {
+    if (playbackPath) {
+        PlaybackSource* playback = new PlaybackSource();
+        if (!playback->open(playbackPath, playbackSpeed, playbackLoop, streams.mask())) {
+            printf("Unable to play back %s\n", playbackPath);
+            delete playback;
+            return NULL;
         }
+        if (playbackSeek > 0) playback->seek((int64_t)(playbackSeek * 1000));
+        return playback;
     }
+    if (syntheticBodies >= 0) return new SyntheticSource(syntheticBodies, syntheticFps, streams);
+    return openKinect(index);
 }
 
-void getKinectDataColor(GLubyte* dest) {
-    NUI_IMAGE_FRAME imageFrame;
-    NUI_LOCKED_RECT LockedRect;
-    if (sensor->NuiImageStreamGetNextFrame(rgbStream, 0, &imageFrame) < 0) return;
-    INuiFrameTexture* texture = imageFrame.pFrameTexture;
-    texture->LockRect(0, &LockedRect, NULL, 0);
+bool initSource() {
+    // Every attached Kinect gets its own pipeline, recordings and synthetic frames as asked
+    int count = playbackPath ? 1 : syntheticBodies >= 0 ? syntheticSensors : kinectSensorCount();
+    if (count > MAX_SENSORS) count = MAX_SENSORS;
+    for (int i = 0; i < count; i++) {
+        FrameSource* source = openSource(i);
+        if (!source) break;
+
+        // Other sensors record next to the first one
+        char path[1024];
+        if (recordPath && i > 0) snprintf(path, sizeof(path), "%s.%d", recordPath, i);
+        startSensor(sensors[sensorCount], sensorCount, source, !recordPath ? NULL : i > 0 ? path : recordPath);
+        // The JSON output wants every sensor's skeletons
+        sensors[sensorCount].capture->subscribe(STREAM_SKELETON);
+        sensorCount++;
+    }
+    return sensorCount > 0;
+}
 
-    if (LockedRect.Pitch != 0)
-    {
-        const BYTE* curr = (const BYTE*)LockedRect.pBits;
-        const BYTE* dataEnd = curr + (camW * camH) * 4;
+void KinectCleanup() {
+    for (int i = 0; i < sensorCount; i++) stopSensor(sensors[i]);
+    sensorCount = 0;
+    // They pointed into the capture buffers
+    depthFrame = NULL;
+    colorFrame = NULL;
+    depthUploaded = colorUploaded = 0;
+    renderSensor = -1;
+    renderStreams = 0;
+    // Sequences start over with the capture threads
+    memset(readSequence, 0, sizeof(readSequence));
+}
 
-        while (curr < dataEnd) {
-            *dest++ = *curr++;
-        }
+// The views want the depth and color of the sensor they show, and nothing while minimized
+void updateRenderDemand(bool visible) {
+    if (!kinectConnected) return;
+    int want = visible ? STREAM_DEPTH | STREAM_COLOR : 0;
+    if (renderSensor == viewSensor && renderStreams == want) return;
+    if (renderSensor >= 0) sensors[renderSensor].capture->unsubscribe(renderStreams);
+    sensors[viewSensor].capture->subscribe(want);
+    renderSensor = viewSensor;
+    // Frames captured for the recorder while the view wasn't reading aren't missed
+    readSequence[viewSensor][0] = readSequence[viewSensor][1] = 0;
+    renderStreams = want;
+}
+
+// Frames of a STREAM_* every sensor dropped, since they were opened
+unsigned long long sensorDropped(int stream) {
+    uint64_t dropped = 0;
+    for (int i = 0; i < sensorCount; i++) dropped += sensors[i].capture->dropped(stream);
+    return dropped;
+}
+
+// Counts the frames between the last one ingest took from a stream, 0 depth, 1 color, 2 skeleton, and this one
+void countUnread(int sensor, int stream, uint64_t sequence) {
+    uint64_t& last = readSequence[sensor][stream];
+    if (last && sequence > last + 1) unreadFrames[stream] += sequence - last - 1;
+    last = sequence;
+}
+
+void updateStageLoad(bool print) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - stageReportTime).count();
+    if (seconds < 1) return;
+    stageReportTime = now;
+
+    // The other threads keep their own totals, they start over when the sensors are reopened
+    stageCpu[STAGE_CAPTURE] = stageCpu[STAGE_RECORD] = 0;
+    for (int i = 0; i < sensorCount; i++) {
+        stageCpu[STAGE_CAPTURE] += sensors[i].capture->cpuMicros();
+        if (sensors[i].recorder) stageCpu[STAGE_RECORD] += sensors[i].recorder->cpuMicros();
+    }
+    // Whatever else the main thread did went to the UI and the views
+    int64_t mainCpu = threadCpuMicros();
+    stageCpu[STAGE_RENDER] = mainCpu - stageCpu[STAGE_INGEST] - stageCpu[STAGE_OUTPUT];
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        int64_t used = stageCpu[i] - stageCpuReported[i];
+        stageLoad[i] = used > 0 ? (float)(used / (seconds * 1e4)) : 0;
+        stageCpuReported[i] = stageCpu[i];
+    }
+    if (print) {
+        printf("CPU per stage:");
+        for (int i = 0; i < STAGE_COUNT; i++) printf(" %s %.1f%%", stageNames[i], stageLoad[i]);
+        printf("\n");
+        printf("Skeleton frame %u, dropped by sensor/unread: depth %llu/%llu, color %llu/%llu, skeleton %llu/%llu\n", bodies.frameNumber,
+            sensorDropped(STREAM_DEPTH), unreadFrames[0], sensorDropped(STREAM_COLOR), unreadFrames[1], sensorDropped(STREAM_SKELETON), unreadFrames[2]);
     }
+}
 
-    texture->UnlockRect(0);
-    sensor->NuiImageStreamReleaseFrame(rgbStream, &imageFrame);
+// Reopens every sensor with the current stream settings
+void restartSensors() {
+    KinectCleanup();
+    // Streams that stay off shouldn't keep showing their last frame
+    depthW = depthH = colorW = colorH = 0;
+    kinectConnected = initSource();
 }
 
-void getKinectDataDepth(GLubyte* dest) {
-    NUI_IMAGE_FRAME imageFrame;
-    NUI_LOCKED_RECT LockedRect;
-    if (sensor->NuiImageStreamGetNextFrame(depthStream, 0, &imageFrame) < 0) return;
-    INuiFrameTexture* texture = imageFrame.pFrameTexture;
-    texture->LockRect(0, &LockedRect, NULL, 0);
+void getSkeletonData(const SkeletonFrame& sF) {
+    updateBodies(bodies, sF);
+    buildBoneStrokes(bodies, boneStrokes);
+    // A long gap, like a seek or a restart, isn't a time step to filter over
+    float dt = (sF.timestamp - lastSkeletonTimestamp) / 1000.0f;
+    lastSkeletonTimestamp = sF.timestamp;
+    jointFilter.apply(bodies, jointFilterSettings, dt > 0 && dt < 0.5f ? dt : 0);
+    history.push(bodies);
+    predictor.update(history);
+    lastSkeletonCapture = sF.captureMicros;
+    activeSkeletons = bodies.count;
+}
 
-    if (LockedRect.Pitch != 0)
-    {
-        const USHORT* curr = (const USHORT*)LockedRect.pBits;
-        const USHORT* dataEnd = curr + (camW * camH);
-
-        while (curr < dataEnd) {
-            // Get depth in millimeters
-            USHORT depth = NuiDepthPixelToDepth(*curr++);
-
-            // Draw a grayscale image of the depth:
-            // B,G,R are all set to depth%256, alpha set to 1.
-            for (int i = 0; i < 3; ++i)
-                *dest++ = (BYTE)(depth % 256);
-            *dest++ = 0xff;
-        }
+// Joints of active body b in output space, w is 1 for joints the sensor found and -1 for the rest
+void bodyPoints(const BodyStore& store, int b, glm::vec4 sp[JOINT_COUNT]) {
+    for (int i = 0; i < JOINT_COUNT; i++) {
+        sp[i] = glm::vec4(store.x[b][i], store.y[b][i], store.z[b][i] + slide,
+            store.state[b][i] == JOINT_NOT_TRACKED ? -1 : 1);
     }
+}
 
-    texture->UnlockRect(0);
-    sensor->NuiImageStreamReleaseFrame(depthStream, &imageFrame);
+// The bodies as the output gets them: interpolated to the output clock if interpolation is on,
+// then extrapolated to when they should be on screen if prediction is on
+const BodyStore& outputBodies() {
+    int64_t now = steadyMicros();
+    const BodyStore* out = &bodies;
+    int64_t captured = lastSkeletonCapture;
+    if (interpolation != INTERPOLATE_NONE && lastSkeletonCapture) {
+        captured = interpolateJoints(history, bodies, now, interpolation, interpolatedBodies);
+        out = &interpolatedBodies;
+    }
+    outputLatencyMs = captured ? (now - captured) / 1000.0f : 0;
+    predictionMs = 0;
+    if (!prediction.enabled) return *out;
+    predictionMs = std::min(outputLatencyMs + prediction.extraMs, prediction.maxMs);
+    predictor.predict(*out, predictionMs / 1000, prediction.acceleration, predictedBodies);
+    return predictedBodies;
+}
+
+void getKinectDataDepth(const DepthFrame& frame, GLubyte* dest) {
+    depthToBgra(frame.pixels.data(), dest, frame.width * frame.height, depthColor);
+}
+
+void sizeDepthTextures(int w, int h) {
+    depthW = w;
+    depthH = h;
+    dataD.assign(w * h * 4, 0);
+    glBindTexture(GL_TEXTURE_2D, texIDD);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h,
+        0, GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)dataD.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    if (depthShaderReady) {
+        glDeleteTextures(1, &texIDDRaw);
+        texIDDRaw = createDepthTexture(w, h);
+    }
+}
+
+void sizeColorTexture(int w, int h) {
+    colorW = w;
+    colorH = h;
+    glBindTexture(GL_TEXTURE_2D, texIDC);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h,
+        0, GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void getKinectData(GLubyte* destD, GLubyte* destC) {
+void getKinectData() {
     if (!kinectConnected) return;
-    getKinectDataDepth(destD);
-    getKinectDataColor(destC);
-    getSkeletonData();
+    if (viewSensor != shownSensor) {
+        depthFrame = NULL;
+        colorFrame = NULL;
+        depthUploaded = colorUploaded = 0;
+        shownSensor = viewSensor;
+    }
+
+    // Only take what the capture threads have published since the last call, never wait for a sensor
+    CaptureThread* view = sensors[shownSensor].capture;
+    if (view->depth.update() || !depthFrame) {
+        depthFrame = &view->depth.readBuffer();
+        countUnread(shownSensor, 0, depthFrame->sequence);
+    }
+    if (view->color.update() || !colorFrame) {
+        colorFrame = &view->color.readBuffer();
+        countUnread(shownSensor, 1, colorFrame->sequence);
+    }
+
+    bool newSkeleton = false;
+    const SkeletonFrame* frames[MAX_SENSORS];
+    glm::mat4 transforms[MAX_SENSORS];
+    for (int i = 0; i < sensorCount; i++) {
+        bool updated = sensors[i].capture->skeleton.update();
+        frames[i] = &sensors[i].capture->skeleton.readBuffer();
+        if (updated) {
+            newSkeleton = true;
+            countUnread(i, 2, frames[i]->sequence);
+        }
+        transforms[i] = sensorTransform(sensors[i]);
+    }
+    if (!newSkeleton) return;
+    mergeSkeletons(frames, transforms, sensorCount, mergedSkeleton);
+    getSkeletonData(mergedSkeleton);
+}
+
+void ingestFrames() {
+    int64_t start = threadCpuMicros();
+    getKinectData();
+    stageCpu[STAGE_INGEST] += threadCpuMicros() - start;
 }
 
-void lineBetween(Vector4 start, Vector4 end) {
+void lineBetween(glm::vec4 start, glm::vec4 end) {
     glVertex3f(start.x, start.y, -start.z);
     glVertex3f(end.x, end.y, -end.z);
 }
 
-void drawSkeleton(Vector4 sp[NUI_SKELETON_POSITION_COUNT]) {
-    const Vector4& lHand = sp[NUI_SKELETON_POSITION_HAND_LEFT];
-    const Vector4& lElbow = sp[NUI_SKELETON_POSITION_ELBOW_LEFT];
-    const Vector4& lShoulder = sp[NUI_SKELETON_POSITION_SHOULDER_LEFT];
-    const Vector4& rHand = sp[NUI_SKELETON_POSITION_HAND_RIGHT];
-    const Vector4& rElbow = sp[NUI_SKELETON_POSITION_ELBOW_RIGHT];
-    const Vector4& rShoulder = sp[NUI_SKELETON_POSITION_SHOULDER_RIGHT];
-    const Vector4& head = sp[NUI_SKELETON_POSITION_HEAD];
-    const Vector4& neck = sp[NUI_SKELETON_POSITION_SHOULDER_CENTER];
-    const Vector4& spine = sp[NUI_SKELETON_POSITION_SPINE];
-    const Vector4& hip = sp[NUI_SKELETON_POSITION_HIP_CENTER];
-    const Vector4& hipL = sp[NUI_SKELETON_POSITION_HIP_LEFT];
-    const Vector4& hipR = sp[NUI_SKELETON_POSITION_HIP_RIGHT];
-    const Vector4& kneeL = sp[NUI_SKELETON_POSITION_KNEE_LEFT];
-    const Vector4& kneeR = sp[NUI_SKELETON_POSITION_KNEE_RIGHT];
-    const Vector4& footL = sp[NUI_SKELETON_POSITION_FOOT_LEFT];
-    const Vector4& footR = sp[NUI_SKELETON_POSITION_FOOT_RIGHT];
-
+// Lines along the strokes of active body b
+void drawSkeleton(glm::vec4 sp[JOINT_COUNT], int b) {
     glBegin(GL_LINES);
-    if (lHand.w > 0 && lElbow.w > 0 && lShoulder.w > 0 && neck.w > 0) {
-        lineBetween(lHand, lElbow);
-        lineBetween(lElbow, lShoulder);
-        lineBetween(lShoulder, neck);
-    }
-    if (rHand.w > 0 && rElbow.w > 0 && rShoulder.w > 0 && neck.w > 0) {
-        lineBetween(rHand, rElbow);
-        lineBetween(rElbow, rShoulder);
-        lineBetween(rShoulder, neck);
-    }
-    if (head.w > 0 && neck.w > 0 && spine.w > 0 && hip.w > 0) {
-        lineBetween(head, neck);
-        lineBetween(neck, spine);
-        lineBetween(spine, hip);
-    }
-    if (hip.w > 0 && hipL.w > 0 && kneeL.w > 0 && footL.w > 0) {
-        lineBetween(hip, hipL);
-        lineBetween(hipL, kneeL);
-        lineBetween(kneeL, footL);
-    }
-    if (hip.w > 0 && hipR.w > 0 && kneeR.w > 0 && footR.w > 0) {
-        lineBetween(hip, hipR);
-        lineBetween(hipR, kneeR);
-        lineBetween(kneeR, footR);
+    for (int s = boneStrokes.bodyStart[b]; s < boneStrokes.bodyStart[b + 1]; s++) {
+        const BoneStroke& stroke = boneStrokes.strokes[s];
+        const JointIndex* joints = boneChains[stroke.chain].joints + stroke.first;
+        for (int i = 1; i < stroke.length; i++) lineBetween(sp[joints[i - 1]], sp[joints[i]]);
     }
     glEnd();
 }
 
+// Fills the image viewport with the bound texture
+void drawImageQuad() {
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex3f(0, 0, 0);
+    glTexCoord2f(1.0f, 0.0f);
+    glVertex3f(camW, 0, 0);
+    glTexCoord2f(1.0f, 1.0f);
+    glVertex3f(camW, camH, 0.0f);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex3f(0, camH, 0.0f);
+    glEnd();
+}
+
 void drawKinectData() {
     if (!kinectConnected) return;
     // OpenGL setup
@@ -263,9 +486,27 @@ void drawKinectData() {
     glEnable(GL_TEXTURE_2D);
 
     // Depth Viewport
-    glBindTexture(GL_TEXTURE_2D, texIDD);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, camW, camH,
-        GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)dataD);
+    bool newDepth = depthFrame && depthFrame->width > 0 && depthFrame->height > 0
+        && (depthFrame->sequence != depthUploaded || gpuDepth != depthUploadedGpu);
+    if (newDepth && (depthFrame->width != depthW || depthFrame->height != depthH))
+        sizeDepthTextures(depthFrame->width, depthFrame->height);
+    if (gpuDepth) {
+        if (newDepth) uploadDepthTexture(texIDDRaw, depthFrame->pixels.data(), depthW, depthH);
+        glBindTexture(GL_TEXTURE_2D, texIDDRaw);
+        beginDepthShader(depthColor);
+    }
+    else {
+        glBindTexture(GL_TEXTURE_2D, texIDD);
+        if (newDepth) {
+            getKinectDataDepth(*depthFrame, dataD.data());
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, depthW, depthH,
+                GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)dataD.data());
+        }
+    }
+    if (newDepth) {
+        depthUploaded = depthFrame->sequence;
+        depthUploadedGpu = gpuDepth;
+    }
 
     glViewport(0, 0, 640, 480);
     glMatrixMode(GL_PROJECTION);
@@ -275,22 +516,19 @@ void drawKinectData() {
     glLoadIdentity();
 
     glClear(GL_DEPTH_BUFFER_BIT);
-    glBegin(GL_QUADS);
-    glTexCoord2f(0.0f, 0.0f);
-    glVertex3f(0, 0, 0);
-    glTexCoord2f(1.0f, 0.0f);
-    glVertex3f(camW, 0, 0);
-    glTexCoord2f(1.0f, 1.0f);
-    glVertex3f(camW, camH, 0.0f);
-    glTexCoord2f(0.0f, 1.0f);
-    glVertex3f(0, camH, 0.0f);
-    glEnd();
+    if (depthW > 0) drawImageQuad();
     glBindTexture(GL_TEXTURE_2D, 0);
+    if (gpuDepth) endDepthShader();
 
     // Color Viewport
+    if (colorFrame && colorFrame->sequence != colorUploaded && colorFrame->width > 0 && colorFrame->height > 0) {
+        if (colorFrame->width != colorW || colorFrame->height != colorH) sizeColorTexture(colorFrame->width, colorFrame->height);
+        glBindTexture(GL_TEXTURE_2D, texIDC);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, colorW, colorH,
+            GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)colorFrame->pixels.data());
+        colorUploaded = colorFrame->sequence;
+    }
     glBindTexture(GL_TEXTURE_2D, texIDC);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, camW, camH,
-        GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)dataC);
 
     glViewport(640, 0, 640, 480);
     glMatrixMode(GL_PROJECTION);
@@ -300,16 +538,7 @@ void drawKinectData() {
     glLoadIdentity();
 
     glClear(GL_DEPTH_BUFFER_BIT);
-    glBegin(GL_QUADS);
-    glTexCoord2f(0.0f, 0.0f);
-    glVertex3f(0, 0, 0);
-    glTexCoord2f(1.0f, 0.0f);
-    glVertex3f(camW, 0, 0);
-    glTexCoord2f(1.0f, 1.0f);
-    glVertex3f(camW, camH, 0.0f);
-    glTexCoord2f(0.0f, 1.0f);
-    glVertex3f(0, camH, 0.0f);
-    glEnd();
+    if (colorW > 0) drawImageQuad();
     glBindTexture(GL_TEXTURE_2D, 0);
 
     // Skeleton Viewport
@@ -322,397 +551,498 @@ void drawKinectData() {
 
     glClear(GL_DEPTH_BUFFER_BIT);
 
-    glColor3f(0.f, 1.f, 0.f);
-    if (activeSkeletons > 0) drawSkeleton(skeletonPosition);
-    glColor3f(0.f, 0.f, 1.f);
-    if (activeSkeletons > 1) drawSkeleton(skeletonPosition2);
+    for (int b = 0; b < bodies.count; b++) {
+        glm::vec4 sp[JOINT_COUNT];
+        bodyPoints(bodies, b, sp);
+        const glm::vec3& color = bodyColors[(bodies.label[b] - 1) % SKELETON_COUNT];
+        glColor3f(color.r, color.g, color.b);
+        drawSkeleton(sp, b);
+    }
     glColor3f(1.f, 1.f, 1.f);
 }
 
-json vertate(Vector4 vert) {
+json vertate(float x, float y, float z) {
     json j;
-    j["x"] = vert.x;
-    j["y"] = vert.y;
-    j["z"] = vert.z;
+    j["x"] = x;
+    j["y"] = y;
+    j["z"] = z;
     return j;
 }
 
-json vertate(Vector4 root, glm::vec3 vert) {
-    json j;
-    j["x"] = root.x + vert.x;
-    j["y"] = root.y + vert.y;
-    j["z"] = root.z + vert.z;
-    return j;
-}
-
-glm::vec3 rotate(glm::vec3 v, glm::vec3 k, float theta) {
-    float sinTheta = sin(theta);
-    float cosTheta = cos(theta);
-    v = (v * cosTheta) + (glm::cross(k, v) * sinTheta) + (k * glm::dot(k, v)) * (1 - cosTheta);
-    return v;
-}
-
-glm::vec3 icovert(int n, int stroke, glm::vec3 rotation, float scale) {
-    const float stroke1[2][3] = { { -0.4472150206565857, -0.5257200002670288, -0.7235999703407288 },{ 0.4472149908542633,-0.8506399989128113,-0.27638503909111023 } };
-    const float stroke2[4][3] = { {0.4472149908542633,-0.8506399989128113,-0.27638503909111023},{-0.4472149908542633,-0.8506399989128113,0.27638503909111023},{-0.4472149610519409,0.0,0.8944249749183655},{-1.0,0.0,4.371138828673793e-08} };
-    const float stroke3[2][3] = { {-1.0,0.0,4.371138828673793e-08},{-0.4472149908542633,0.8506399989128113,0.27638503909111023} };
-    const float stroke4[4][3] = { {-0.4472149908542633,0.8506399989128113,0.27638503909111023},{-0.4472150206565857,0.5257200002670288,-0.7235999703407288},{0.4472149610519409,0.0,-0.8944249749183655},{-0.4472150206565857,-0.5257200002670288,-0.7235999703407288} };
-    const float stroke5[2][3] = { {-0.4472150206565857,-0.5257200002670288,-0.7235999703407288},{-0.4472150206565857,0.5257200002670288,-0.7235999703407288} };
-    const float stroke6[4][3] = { {-0.4472150206565857,0.5257200002670288,-0.7235999703407288},{-1.0,0.0,4.371138828673793e-08},{-0.4472150206565857,-0.5257200002670288,-0.7235999703407288},{-0.4472149908542633,-0.8506399989128113,0.27638503909111023} };
-    const float stroke7[2][3] = { {-0.4472149908542633,-0.8506399989128113,0.27638503909111023},{-1.0,0.0,4.371138828673793e-08} };
-    const float stroke8[2][3] = { {-0.4472149908542633,-0.8506399989128113,0.27638503909111023},{0.4472150206565857,-0.5257200002670288,0.7235999703407288} };
-    const float stroke9[4][3] = { {0.4472150206565857,-0.5257200002670288,0.7235999703407288},{-0.4472149610519409,0.0,0.8944249749183655},{-0.4472149908542633,0.8506399989128113,0.27638503909111023},{0.4472150206565857,0.5257200002670288,0.7235999703407288} };
-    const float stroke10[2][3] = { {0.4472150206565857,0.5257200002670288,0.7235999703407288},{-0.4472149610519409,0.0,0.8944249749183655} };
-    const float stroke11[2][3] = { {-0.4472149908542633,0.8506399989128113,0.27638503909111023},{0.4472149908542633,0.8506399989128113,-0.27638503909111023} };
-    const float stroke12[2][3] = { {0.4472149908542633,0.8506399989128113,-0.27638503909111023},{-0.4472150206565857,0.5257200002670288,-0.7235999703407288} };
-    const float stroke13[2][3] = { {0.4472149610519409,0.0,-0.8944249749183655},{1.0,0.0,-4.371138828673793e-08} };
-    const float stroke14[2][3] = { {1.0,0.0,-4.371138828673793e-08},{0.4472149908542633,-0.8506399989128113,-0.27638503909111023} };
-    const float stroke15[4][3] = { {0.4472149908542633,-0.8506399989128113,-0.27638503909111023},{0.4472150206565857,-0.5257200002670288,0.7235999703407288},{0.4472150206565857,0.5257200002670288,0.7235999703407288},{0.4472149908542633,0.8506399989128113,-0.27638503909111023} };
-    const float stroke16[3][3] = { {0.4472149908542633,0.8506399989128113,-0.27638503909111023},{0.4472149610519409,0.0,-0.8944249749183655},{0.4472149908542633,-0.8506399989128113,-0.27638503909111023} };
-    const float stroke17[3][3] = { {0.4472150206565857,0.5257200002670288,0.7235999703407288},{1.0,0.0,-4.371138828673793e-08},{0.4472150206565857,-0.5257200002670288,0.7235999703407288} };
-    const float stroke18[2][3] = { {1.0,0.0,-4.371138828673793e-08},{0.4472149908542633,0.8506399989128113,-0.27638503909111023} };
-
-    glm::vec3 v = { 0,0,0 };
-
-    switch (stroke) {
-    case 0:
-        v = { stroke1[n][0], stroke1[n][1], stroke1[n][2]};
-        break;
-    case 1:
-        v = { stroke2[n][0], stroke2[n][1], stroke2[n][2]};
-        break;
-    case 2:
-        v = { stroke3[n][0], stroke3[n][1], stroke3[n][2]};
-        break;
-    case 3:
-        v = { stroke4[n][0], stroke4[n][1], stroke4[n][2]};
-        break;
-    case 4:
-        v = { stroke5[n][0], stroke5[n][1], stroke5[n][2]};
-        break;
-    case 5:
-        v = { stroke6[n][0], stroke6[n][1], stroke6[n][2]};
-        break;
-    case 6:
-        v = { stroke7[n][0], stroke7[n][1], stroke7[n][2]};
-        break;
-    case 7:
-        v = { stroke8[n][0], stroke8[n][1], stroke8[n][2]};
-        break;
-    case 8:
-        v = { stroke9[n][0], stroke9[n][1], stroke9[n][2]};
-        break;
-    case 9:
-        v = { stroke10[n][0], stroke10[n][1], stroke10[n][2]};
-        break;
-    case 10:
-        v = { stroke11[n][0], stroke11[n][1], stroke11[n][2]};
-        break;
-    case 11:
-        v = { stroke12[n][0], stroke12[n][1], stroke12[n][2]};
-        break;
-    case 12:
-        v = { stroke13[n][0], stroke13[n][1], stroke13[n][2]};
-        break;
-    case 13:
-        v = { stroke14[n][0], stroke14[n][1], stroke14[n][2]};
-        break;
-    case 14:
-        v = { stroke15[n][0], stroke15[n][1], stroke15[n][2]};
-        break;
-    case 15:
-        v = { stroke16[n][0], stroke16[n][1], stroke16[n][2]};
-        break;
-    case 16:
-        v = { stroke17[n][0], stroke17[n][1], stroke17[n][2]};
-        break;
-    case 17:
-        v = { stroke18[n][0], stroke18[n][1], stroke18[n][2]};
-        break;
-    }
-
-    const glm::vec3 unitX = { 1.f, 0.f, 0.f };
-    const glm::vec3 unitY = { 0.f, 1.f, 0.f };
-    const glm::vec3 unitZ = { 0.f, 0.f, 1.f };
+// The primitives attached to one body's joints, scale is in tenths of a meter
+void addPrimitives(MeshBatch& batch, glm::vec4 sp[JOINT_COUNT]) {
+    const glm::vec4& lHand = sp[JOINT_HAND_LEFT];
+    const glm::vec4& rHand = sp[JOINT_HAND_RIGHT];
+    const glm::vec4& head = sp[JOINT_HEAD];
+    const glm::vec4& footL = sp[JOINT_FOOT_LEFT];
+    const glm::vec4& footR = sp[JOINT_FOOT_RIGHT];
 
-    v = v * scale;
-    v = rotate(v, unitX, rotation.x);
-    v = rotate(v, unitY, rotation.y);
-    v = rotate(v, unitZ, rotation.z);
-    return v;
-}
-
-json genIco(json j, Vector4 root, glm::vec3 rotation, float scale) {
-    scale = scale * 0.1;
-    json stroke;
-    int k = 0;
-
-    {
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 4; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 4; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 4; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 4; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 4; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 3; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 3; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-        k++;
-
-        for (int i = 0; i < 2; i++) stroke.push_back(vertate(root, icovert(i, k, rotation, scale)));
-        j["vertices"].push_back(stroke);
-        stroke = json();
-    }
-
-    return j;
-}
-
-glm::vec3 cubevert(int n, glm::vec3 rotation, float scale) {
-    const float cVerts[16][3] =
-    {   {-1.f, -1.f, -1.f},
-        {-1.f, -1.f, 1.f},
-        {-1.f, 1.f, 1.f},
-        {1.f, 1.f, 1.f},
-        {1.f, 1.f, -1.f},
-        {-1.f, 1.f, -1.f},
-        {-1.f, -1.f, -1.f},
-        {1.f, -1.f, -1.f},
-        {1.f, -1.f, 1.f},
-        {-1.f, -1.f, 1.f},
-        {-1.f, 1.f, 1.f},
-        {-1.f, 1.f, -1.f},
-        {1.f, 1.f, -1.f},
-        {1.f, -1.f, -1.f},
-        {1.f, -1.f, 1.f},
-        {1.f, 1.f, 1.f}
-    };
-
-    const glm::vec3 unitX = { 1.f, 0.f, 0.f };
-    const glm::vec3 unitY = { 0.f, 1.f, 0.f };
-    const glm::vec3 unitZ = { 0.f, 0.f, 1.f };
-
-    glm::vec3 v = { cVerts[n][0], cVerts[n][1], cVerts[n][2] };
-    v = v * scale;
-    v = rotate(v, unitX, rotation.x);
-    v = rotate(v, unitY, rotation.y);
-    v = rotate(v, unitZ, rotation.z);
-    return v;
-}
-
-json genCube(json j, Vector4 root, glm::vec3 cubeRotation, float scale) {
-    scale = scale * 0.1;
-    json stroke;
-    for (int i = 0; i < 16; i++) stroke.push_back(vertate(root, cubevert(i, cubeRotation, scale)));
-    j["vertices"].push_back(stroke);
-    return j;
-}
-
-json skeletate(json skelet, Vector4 sp[NUI_SKELETON_POSITION_COUNT]) {
-    const Vector4& lHand = sp[NUI_SKELETON_POSITION_HAND_LEFT];
-    const Vector4& lElbow = sp[NUI_SKELETON_POSITION_ELBOW_LEFT];
-    const Vector4& lShoulder = sp[NUI_SKELETON_POSITION_SHOULDER_LEFT];
-    const Vector4& rHand = sp[NUI_SKELETON_POSITION_HAND_RIGHT];
-    const Vector4& rElbow = sp[NUI_SKELETON_POSITION_ELBOW_RIGHT];
-    const Vector4& rShoulder = sp[NUI_SKELETON_POSITION_SHOULDER_RIGHT];
-    const Vector4& head = sp[NUI_SKELETON_POSITION_HEAD];
-    const Vector4& neck = sp[NUI_SKELETON_POSITION_SHOULDER_CENTER];
-    const Vector4& spine = sp[NUI_SKELETON_POSITION_SPINE];
-    const Vector4& hip = sp[NUI_SKELETON_POSITION_HIP_CENTER];
-    const Vector4& hipL = sp[NUI_SKELETON_POSITION_HIP_LEFT];
-    const Vector4& hipR = sp[NUI_SKELETON_POSITION_HIP_RIGHT];
-    const Vector4& kneeL = sp[NUI_SKELETON_POSITION_KNEE_LEFT];
-    const Vector4& kneeR = sp[NUI_SKELETON_POSITION_KNEE_RIGHT];
-    const Vector4& footL = sp[NUI_SKELETON_POSITION_FOOT_LEFT];
-    const Vector4& footR = sp[NUI_SKELETON_POSITION_FOOT_RIGHT];
-
-    if (lHand.w > 0 && lElbow.w > 0 && lShoulder.w > 0 && neck.w > 0) {
-        json stroke;
-        stroke.push_back(vertate(lHand));
-        stroke.push_back(vertate(lElbow));
-        stroke.push_back(vertate(lShoulder));
-        stroke.push_back(vertate(neck));
-        skelet["vertices"].push_back(stroke);
-    }
-    if (rHand.w > 0 && rElbow.w > 0 && rShoulder.w > 0 && neck.w > 0) {
-        json stroke;
-        stroke.push_back(vertate(neck));
-        stroke.push_back(vertate(rShoulder));
-        stroke.push_back(vertate(rElbow));
-        stroke.push_back(vertate(rHand));
-        skelet["vertices"].push_back(stroke);
-    }
-    if (head.w > 0 && neck.w > 0 && spine.w > 0 && hip.w > 0) {
-        json stroke;
-        stroke.push_back(vertate(head));
-        stroke.push_back(vertate(neck));
-        stroke.push_back(vertate(spine));
-        stroke.push_back(vertate(hip));
-        skelet["vertices"].push_back(stroke);
-    }
-    if (hip.w > 0 && hipL.w > 0 && kneeL.w > 0 && footL.w > 0) {
-        json stroke;
-        stroke.push_back(vertate(footL));
-        stroke.push_back(vertate(kneeL));
-        stroke.push_back(vertate(hipL));
-        stroke.push_back(vertate(hip));
-        skelet["vertices"].push_back(stroke);
-    }
-    if (hip.w > 0 && hipR.w > 0 && kneeR.w > 0 && footR.w > 0) {
-        json stroke;
-        stroke.push_back(vertate(hip));
-        stroke.push_back(vertate(hipR));
-        stroke.push_back(vertate(kneeR));
-        stroke.push_back(vertate(footR));
-        skelet["vertices"].push_back(stroke);
-    }
     if (headCube && head.w > 0) {
-        skelet = genCube(skelet, head, headCubeRotation, 2);
+        batch.add(cubeMesh, primitiveTransform(head, headCubeRotation, 0.2f));
     }
     if (headIco && head.w > 0) {
-        skelet = genIco(skelet, head, headIcoRotation, 1.5);
+        batch.add(icoMesh, primitiveTransform(head, headIcoRotation, 0.15f));
     }
     if (handCube && lHand.w > 0) {
-        skelet = genCube(skelet, lHand, handCubeRotationL, 1);
+        batch.add(cubeMesh, primitiveTransform(lHand, handCubeRotationL, 0.1f));
     }
     if (handCube && rHand.w > 0) {
-        skelet = genCube(skelet, rHand, handCubeRotationR, 1);
+        batch.add(cubeMesh, primitiveTransform(rHand, handCubeRotationR, 0.1f));
     }
     if (footCube && footL.w > 0) {
-        skelet = genCube(skelet, footL, footCubeRotationL, 1);
+        batch.add(cubeMesh, primitiveTransform(footL, footCubeRotationL, 0.1f));
     }
     if (footCube && footR.w > 0) {
-        skelet = genCube(skelet, footR, footCubeRotationR, 1);
+        batch.add(cubeMesh, primitiveTransform(footR, footCubeRotationR, 0.1f));
     }
-    return skelet;
 }
 
-void makeJson() {
-    json newJson = skeletonJson;
-    json skelet1, skelet2, ico, matrix;
+// Bone strokes of active body b, then its primitives' strokes, instances [first, last) of the batch.
+// False once the geometry frame is full, with what fit of the body in it.
+bool skeletate(FrameGeometry& geometry, glm::vec4 sp[JOINT_COUNT], int b, const MeshBatch& batch, int first, int last) {
+    for (int s = boneStrokes.bodyStart[b]; s < boneStrokes.bodyStart[b + 1]; s++) {
+        const BoneStroke& bones = boneStrokes.strokes[s];
+        const JointIndex* joints = boneChains[bones.chain].joints + bones.first;
+        if (!geometry.beginStroke()) return false;
+        for (int i = 0; i < bones.length; i++) {
+            if (!geometry.addVertex(sp[joints[i]].x, sp[joints[i]].y, sp[joints[i]].z)) return false;
+        }
+    }
+    for (int k = first; k < last; k++) {
+        const WireMesh& mesh = *batch.mesh[k];
+        int start = batch.vertexStart[k];
+        for (int s = 0; s < mesh.strokeCount; s++) {
+            if (!geometry.beginStroke()) return false;
+            for (int i = start + mesh.strokeStart[s]; i < start + mesh.strokeStart[s + 1]; i++) {
+                if (!geometry.addVertex(batch.x[i], batch.y[i], batch.z[i])) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Everything the output draws this frame, into the next geometry frame
+void makeGeometry() {
+    const BodyStore& out = outputBodies();
+    geometryFrame = !geometryFrame;
+    FrameGeometry& geometry = geometryFrames[geometryFrame];
+    geometry.clear();
+    geometry.timestamp = out.timestamp;
+    geometry.frameNumber = out.frameNumber;
+    geometry.latencyMs = outputLatencyMs;
+
+    // Every body's primitives go through one transform
+    glm::vec4 sp[SKELETON_COUNT][JOINT_COUNT];
+    int firstPrimitive[SKELETON_COUNT + 1];
+    primitives.clear();
+    for (int b = 0; b < out.count; b++) {
+        bodyPoints(out, b, sp[b]);
+        firstPrimitive[b] = primitives.count;
+        addPrimitives(primitives, sp[b]);
+    }
+    firstPrimitive[out.count] = primitives.count;
+    transformBatch(primitives);
+
+    // One object per active body, labeled so it stays the same object across frames
+    // The bodies that don't fit once the frame is full are left out
+    for (int b = 0; b < out.count; b++) {
+        if (!geometry.beginObject(out.label[b]) ||
+            !skeletate(geometry, sp[b], b, primitives, firstPrimitive[b], firstPrimitive[b + 1])) break;
+    }
+    quantizeGeometry(geometry, gridMm / 1000);
+    geometryChanged = !sameGeometry(geometry, geometryFrames[!geometryFrame]);
+}
 
-    matrix = {
+// The osci-render scene for a geometry frame through the nlohmann::json tree, as it was built
+// before writeScene(). Kept as the reference --bench-json checks the writer against.
+void geometryJson(const FrameGeometry& geometry, std::string& j) {
+    json matrix = {
         1, 0, 0, 0,
         0, 1, 0, 0,
         0, 0, -1, -1,
         0, 0, -1, 1 };
 
-    skelet1["name"] = "Skeleton 1";
-    skelet1 = skeletate(skelet1, skeletonPosition);
-    skelet1["matrix"] = matrix;
+    json scene;
+    for (int o = 0; o < geometry.objectCount; o++) {
+        json skelet;
+        skelet["name"] = "Skeleton " + std::to_string(geometry.objects[o].label);
+        for (int s = geometry.objects[o].firstStroke; s < geometry.objects[o + 1].firstStroke; s++) {
+            json stroke;
+            for (int i = geometry.strokeStart[s]; i < geometry.strokeStart[s + 1]; i++) {
+                stroke.push_back(vertate(geometry.x[i], geometry.y[i], geometry.z[i]));
+            }
+            skelet["vertices"].push_back(stroke);
+        }
+        skelet["matrix"] = matrix;
+        scene["objects"].push_back(skelet);
+    }
+    scene["focalLength"] = -2.5;
+    if (sendFrameInfo) {
+        scene["frameNumber"] = geometry.frameNumber;
+        scene["timestamp"] = geometry.timestamp;
+        scene["latencyMs"] = geometry.latencyMs;
+    }
+    j = scene.dump();
+}
 
-    skelet2["name"] = "Skeleton 2";
-    skelet2 = skeletate(skelet2, skeletonPosition2);
-    skelet2["matrix"] = matrix;
+// Every skeleton object's matrix, and the idle frame's line art and its matrix
+const float skeletonMatrix[16] = {
+    1, 0, 0, 0,
+    0, 1, 0, 0,
+    0, 0, -1, -1,
+    0, 0, -1, 1 };
+const float idleMatrix[16] = {
+    1.1111111640930176f, 0, 0, 0,
+    0, 1.1111111640930176f, 0, 0,
+    0, 0, 1.1111111640930176f, -11.111111640930176f,
+    0, 0, 0, 1 };
+
+const FrameGeometry& idleGeometry() {
+    static FrameGeometry idle;
+    if (idle.objectCount == 0) {
+        const float square[5][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f }, { -0.5f, -0.5f } };
+        idle.beginObject(0);
+        idle.beginStroke();
+        for (int i = 0; i < 5; i++) idle.addVertex(square[i][0], square[i][1], 8.610005378723145f);
+    }
+    return idle;
+}
 
-    newJson = json();
-    if (activeSkeletons > 0) {
-        newJson["objects"].push_back(skelet1);
-        if (activeSkeletons > 1) newJson["objects"].push_back(skelet2);
+// What sendOsciRender() puts on the wire this frame, false if there's nothing to send
+bool serializeOsciRender(std::string& j) {
+    if (activeSkeletons == 0) {
+        if (binaryOutput) {
+            binaryEncoder.write(idleGeometry(), idleMatrix, false, binaryPrecision, keyframeInterval, j);
+            return true;
+        }
+        j = "{\"objects\": [{\"name\":\"Line Art\", \"vertices\" : [[{\"x\":-0.5, \"y\" : -0.5, \"z\" : 8.610005378723145}, {\"x\":0.5,\"y\" : -0.5,\"z\" : 8.610005378723145}, {\"x\":0.5,\"y\" : 0.5,\"z\" : 8.610005378723145}, {\"x\":-0.5,\"y\" : 0.5,\"z\" : 8.610005378723145}, {\"x\":-0.5,\"y\" : -0.5,\"z\" : 8.610005378723145}]], \"matrix\" : [1.1111111640930176, 0.0, 0.0, 0.0, 0.0, 1.1111111640930176, 0.0, 0.0, 0.0, 0.0, 1.1111111640930176, -11.111111640930176, 0.0, 0.0, 0.0, 1.0] }] , \"focalLength\" : -2.5}";
+        return true;
+    }
+    if (geometryChanged) {
+        if (binaryOutput) binaryEncoder.write(geometryFrames[geometryFrame], skeletonMatrix, sendFrameInfo, binaryPrecision, keyframeInterval, j);
+        else writeScene(geometryFrames[geometryFrame], sendFrameInfo, j);
+        return true;
     }
-    skeletonJsonChanged = newJson != skeletonJson;
-    newJson["focalLength"] = -2.5;
-    skeletonJson = newJson;
+    return false;
 }
 
+// Kept from frame to frame, so it stops allocating once it has grown to the frame size
+std::string outputBuffer;
+
 int sendOsciRender() {
-    if (activeSkeletons == 0) {
-        std::string j = "{\"objects\": [{\"name\":\"Line Art\", \"vertices\" : [[{\"x\":-0.5, \"y\" : -0.5, \"z\" : 8.610005378723145}, {\"x\":0.5,\"y\" : -0.5,\"z\" : 8.610005378723145}, {\"x\":0.5,\"y\" : 0.5,\"z\" : 8.610005378723145}, {\"x\":-0.5,\"y\" : 0.5,\"z\" : 8.610005378723145}, {\"x\":-0.5,\"y\" : -0.5,\"z\" : 8.610005378723145}]], \"matrix\" : [1.1111111640930176, 0.0, 0.0, 0.0, 0.0, 1.1111111640930176, 0.0, 0.0, 0.0, 0.0, 1.1111111640930176, -11.111111640930176, 0.0, 0.0, 0.0, 1.0] }] , \"focalLength\" : -2.5}";
-        int iResult = send(orsock, j.c_str(), j.length(), 0);
-        if (iResult == SOCKET_ERROR) {
-            return 1;
+    std::string& j = outputBuffer;
+    if (!serializeOsciRender(j)) return 0;
+    int iResult = send(orsock, j.c_str(), j.length(), MSG_NOSIGNAL);
+    if (iResult == SOCKET_ERROR) {
+        return 1;
+    }
+    return 0;
+}
+
+// Turns the primitives by delt seconds worth of their speeds
+void spinPrimitives(float delt) {
+    headCubeRotation = headCubeRotation + glm::vec3({ headCSpeedX * delt, headCSpeedY * delt, headCSpeedZ * delt });
+    headIcoRotation = headIcoRotation + glm::vec3({ headISpeedX * delt, headISpeedY * delt, headISpeedZ * delt });
+
+    handCubeRotationL = handCubeRotationL + glm::vec3({ handCSpeedX * delt, handCSpeedY * delt, handCSpeedZ * delt });
+    handCubeRotationR = handCubeRotationR + glm::vec3({ -handCSpeedX * delt, -handCSpeedY * delt, -handCSpeedZ * delt });
+
+    footCubeRotationL = footCubeRotationL + glm::vec3({ footCSpeedX * delt, footCSpeedY * delt, footCSpeedZ * delt });
+    footCubeRotationR = footCubeRotationR + glm::vec3({ -footCSpeedX * delt, -footCSpeedY * delt, -footCSpeedZ * delt });
+}
+
+bool parseFilter(const char* text, FilterType& type) {
+    if (!strcmp(text, "none")) type = FILTER_NONE;
+    else if (!strcmp(text, "euro")) type = FILTER_ONE_EURO;
+    else if (!strcmp(text, "dexp")) type = FILTER_DOUBLE_EXPONENTIAL;
+    else return false;
+    return true;
+}
+
+bool parseBinary(const char* text, BinaryPrecision& precision) {
+    if (!strcmp(text, "f32")) precision = BINARY_FLOAT32;
+    else if (!strcmp(text, "f16")) precision = BINARY_FLOAT16;
+    else return false;
+    return true;
+}
+
+bool parseInterpolation(const char* text, InterpolationMode& mode) {
+    if (!strcmp(text, "none")) mode = INTERPOLATE_NONE;
+    else if (!strcmp(text, "lerp")) mode = INTERPOLATE_LINEAR;
+    else if (!strcmp(text, "catmull")) mode = INTERPOLATE_CATMULL_ROM;
+    else return false;
+    return true;
+}
+
+// "off" or one of the resolutions the stream supports
+bool parseResolution(const char* text, bool color, Resolution& resolution) {
+    if (!strcmp(text, "off")) resolution = RESOLUTION_OFF;
+    else if (!color && !strcmp(text, "80x60")) resolution = RESOLUTION_80x60;
+    else if (!color && !strcmp(text, "320x240")) resolution = RESOLUTION_320x240;
+    else if (!strcmp(text, "640x480")) resolution = RESOLUTION_640x480;
+    else if (color && !strcmp(text, "1280x960")) resolution = RESOLUTION_1280x960;
+    else return false;
+    return true;
+}
+
+int outputJson() {
+    int64_t start = threadCpuMicros();
+    makeGeometry();
+    int result = sendOsciRender();
+    stageCpu[STAGE_OUTPUT] += threadCpuMicros() - start;
+    return result;
+}
+
+// Tells the receiver we're done and closes the socket
+bool closeConnection() {
+    std::string close = "CLOSE\n";
+    send(orsock, close.c_str(), close.length(), 0);
+    shutdown(orsock, 2);
+    int iResult = closesocket(orsock);
+    if (iResult == SOCKET_ERROR) printf("closesocket failed with error = %d\n", WSAGetLastError());
+    netCleanup();
+    return iResult != SOCKET_ERROR;
+}
+
+// The window's output clock at outputRate, as close as its frames get to it.
+// Whether an output is due, and if so the seconds since the last one in delt.
+std::chrono::steady_clock::time_point lastOutput = std::chrono::steady_clock::now();
+std::chrono::steady_clock::time_point nextOutput = lastOutput;
+bool outputDue(float& delt) {
+    typedef std::chrono::steady_clock clock;
+    clock::time_point now = clock::now();
+    if (now < nextOutput) return false;
+    nextOutput += std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1 / outputRate));
+    // Don't try to catch up after a stall
+    if (nextOutput < now) nextOutput = now;
+    delt = std::chrono::duration<float>(now - lastOutput).count();
+    lastOutput = now;
+    return true;
+}
+
+std::atomic<bool> quitRequested(false);
+
+void requestQuit(int) {
+    quitRequested = true;
+}
+
+// Capture, skeletons, geometry and output with no SDL video, window or GL context.
+// Paced by the first sensor's skeleton frames, or by a fixed clock at outputRate.
+// Runs until SIGINT or SIGTERM, or until sending fails.
+bool runHeadless() {
+    signal(SIGINT, requestQuit);
+    signal(SIGTERM, requestQuit);
+
+    kinectConnected = initSource();
+    // Without a sensor the idle frame still goes out, like the window does
+    float rate = outputRate;
+    if (!kinectConnected) {
+        if (rate <= 0) rate = 30;
+        printf("No sensor, sending the idle frame at %.0f Hz\n", rate);
+    }
+
+    typedef std::chrono::steady_clock clock;
+    clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(rate > 0 ? 1 / rate : 0));
+    clock::time_point last = clock::now();
+    clock::time_point next = last;
+    uint64_t seen = 0;
+    bool ok = true;
+    while (!quitRequested) {
+        if (rate > 0) {
+            next += period;
+            // Don't try to catch up after a stall
+            if (next < clock::now()) next = clock::now();
+            std::this_thread::sleep_until(next);
         }
+        else {
+            uint64_t sequence = sensors[0].capture->waitForSkeleton(seen, 100);
+            updateStageLoad(true);
+            if (sequence == seen) continue;
+            seen = sequence;
+        }
+
+        clock::time_point now = clock::now();
+        float delt = std::chrono::duration<float>(now - last).count();
+        last = now;
+
+        ingestFrames();
+        spinPrimitives(delt);
+        int iResult = outputJson();
+        if (iResult != 0) {
+            printf("Sending data failed! code %d\n", iResult);
+            ok = false;
+            break;
+        }
+        updateStageLoad(true);
     }
-    else if (skeletonJsonChanged) {
-        std::string j = skeletonJson.dump();
-        std::cout << "JSON Sending" << std::endl;
-        int iResult = send(orsock, j.c_str(), j.length(), 0);
-        if (iResult == SOCKET_ERROR) {
-            return 1;
+    KinectCleanup();
+    return ok;
+}
+
+bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(arg, "--synthetic") && hasValue) syntheticBodies = atoi(argv[++i]);
+        else if (!strcmp(arg, "--sensors") && hasValue) syntheticSensors = atoi(argv[++i]);
+        else if (!strcmp(arg, "--depth") && hasValue && parseResolution(argv[i + 1], false, streams.depth)) i++;
+        else if (!strcmp(arg, "--color") && hasValue && parseResolution(argv[i + 1], true, streams.color)) i++;
+        else if (!strcmp(arg, "--place") && i + 5 < argc) {
+            int s = atoi(argv[++i]);
+            float x = (float)atof(argv[++i]), y = (float)atof(argv[++i]), z = (float)atof(argv[++i]);
+            float yaw = (float)atof(argv[++i]);
+            if (s >= 0 && s < MAX_SENSORS) {
+                sensors[s].position = glm::vec3(x, y, z);
+                sensors[s].yaw = yaw;
+            }
+        }
+        else if (!strcmp(arg, "--fps") && hasValue) syntheticFps = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--play") && hasValue) playbackPath = argv[++i];
+        else if (!strcmp(arg, "--speed") && hasValue) playbackSpeed = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--loop")) playbackLoop = true;
+        else if (!strcmp(arg, "--seek") && hasValue) playbackSeek = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--record") && hasValue) recordPath = argv[++i];
+        else if (!strcmp(arg, "--bench-depth")) benchDepth = true;
+        else if (!strcmp(arg, "--bench-replay") && hasValue) benchReplayFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--bench-sensors") && hasValue) benchSensorCount = atoi(argv[++i]);
+        else if (!strcmp(arg, "--bench-bodies") && hasValue) benchBodyFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--bench-filter") && hasValue) benchFilterFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--bench-predict") && hasValue) benchPredictFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--bench-primitives") && hasValue) benchPrimitiveFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--bench-json") && hasValue) benchJsonFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--predict") && hasValue) {
+            prediction.enabled = true;
+            prediction.extraMs = (float)atof(argv[++i]);
+        }
+        else if (!strcmp(arg, "--filter") && hasValue && parseFilter(argv[i + 1], jointFilterSettings.type)) i++;
+        else if (!strcmp(arg, "--frame-info")) sendFrameInfo = true;
+        else if (!strcmp(arg, "--binary") && hasValue && parseBinary(argv[i + 1], binaryPrecision)) {
+            binaryOutput = true;
+            i++;
+        }
+        else if (!strcmp(arg, "--delta") && hasValue) {
+            binaryOutput = true;
+            keyframeInterval = std::max(1, atoi(argv[++i]));
+        }
+        else if (!strcmp(arg, "--receive")) receive = true;
+        else if (!strcmp(arg, "--grid") && hasValue) gridMm = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--bench-grid") && hasValue) benchGridFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--check-delta") && hasValue) checkDeltaFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--bench-binary") && hasValue) benchBinaryFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--check-gpu-depth")) checkGpuDepth = true;
+        else if (!strcmp(arg, "--check-allocations") && hasValue) checkAllocationFrames = atoi(argv[++i]);
+        else if (!strcmp(arg, "--headless")) headless = true;
+        else if (!strcmp(arg, "--rate") && hasValue) outputRate = (float)atof(argv[++i]);
+        else if (!strcmp(arg, "--interpolate") && hasValue && parseInterpolation(argv[i + 1], interpolation)) i++;
+        else {
+            printf("Usage: ORKinect [options]\n"
+                "  --synthetic <bodies>  Use generated frames instead of a Kinect\n"
+                "  --sensors <count>     Number of synthetic sensors (default 1), Kinects are all used\n"
+                "  --fps <rate>          Synthetic frame rate, 0 for as fast as possible (default 30)\n"
+                "  --depth <size>        Depth stream: 80x60, 320x240, 640x480 (default) or off\n"
+                "  --color <size>        Color stream: 640x480 at 30 fps (default), 1280x960 at 12 fps or off\n"
+                "  --play <file>         Play back a recorded session instead of a Kinect\n"
+                "  --speed <factor>      Playback speed, 0 for as fast as possible (default 1)\n"
+                "  --loop                Restart the playback when it ends\n"
+                "  --seek <seconds>      Start the playback this far into the recording\n"
+                "  --record <file>       Record every captured frame, other sensors to <file>.1 and so on\n"
+                "  --place <sensor> <x> <y> <z> <yaw>\n"
+                "                        Where a sensor stands in the shared space, meters and degrees\n"
+                "  --bench-depth         Benchmark the depth view conversion and exit\n"
+                "  --bench-replay <n>    Run n skeleton frames from --play or --synthetic (default 2 bodies)\n"
+                "                        through the JSON output as fast as possible, report timings and exit\n"
+                "  --bench-sensors <n>   Capture from 1 to n unpaced synthetic sensors, report scaling and exit\n"
+                "  --bench-bodies <n>    Run n skeleton frames with 1, 2 and 6 bodies through the output, report and exit\n"
+                "  --filter <type>       Joint filter: none, euro (One-Euro) or dexp (double exponential, default)\n"
+                "  --bench-filter <n>    Compare joint filters' jitter and latency on n frames from --play, or from\n"
+                "                        --synthetic with 5 mm of added noise, and exit\n"
+                "  --predict <ms>        Extrapolate joints over the measured output latency plus ms\n"
+                "  --bench-predict <n>   Report the error of predicting 1 to 6 frames ahead on n frames, and exit\n"
+                "  --bench-primitives <n> Time n frames of primitive vertices, batched against one by one, and exit\n"
+                "  --bench-json <n>      Serialize n frames of 1, 2 and 6 bodies with the writer and the json tree,\n"
+                "                        check they match and report the throughput of each, and exit\n"
+                "  --frame-info          Add the skeleton frame number, sensor time and latency to the JSON\n"
+                "  --grid <mm>           Snap the output vertices to a grid, 0 for none (default 0.5)\n"
+                "  --bench-grid <n>      Report how often n frames of a still, noisy performer change and what\n"
+                "                        they cost to send on grids from none to 5 mm, and exit\n"
+                "  --binary <precision>  Send the binary framing instead of JSON, vertices as f32 or f16\n"
+                "  --delta <frames>      Send binary deltas against the last frame, a keyframe every <frames>\n"
+                "                        messages, as f32 unless --binary says otherwise\n"
+                "  --receive             Listen for --binary output in place of osci-render, report what arrives\n"
+                "                        and exit when the sender closes\n"
+                "  --bench-binary <n>    Encode and decode n frames of 1, 2 and 6 bodies as JSON and binary,\n"
+                "                        check the binary reads back and report sizes and times, and exit\n"
+                "  --check-delta <n>     Replay n frames of moving, still and frozen bodies as keyframes and as\n"
+                "                        deltas, check both decode to the same scenes, report sizes and exit\n"
+                "  --check-gpu-depth     Compare the depth view shader with the CPU conversion and exit\n"
+                "  --check-allocations <n> Count heap allocations per stage over n frames of 6 bodies and exit\n"
+                "  --headless            Run capture and output only, with no window, until interrupted\n"
+                "  --rate <hz>           Output rate, 0 to follow the skeleton frames headless or send every\n"
+                "                        4th window frame (default 0)\n"
+                "  --interpolate <mode>  Resample joints to the output rate: none (default), lerp or catmull\n");
+            return false;
         }
     }
-    return 0;
+    return true;
+}
+
+void setGLAttributes() {
+    // GL 3.0 + GLSL 130
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+}
+
+// Runs the depth shader check in a hidden window, e.g. with LIBGL_ALWAYS_SOFTWARE=1 on Mesa
+int checkDepthShaderMain() {
+    if (!SDL_Init(SDL_INIT_VIDEO))
+    {
+        printf("Error: SDL_Init(): %s\n", SDL_GetError());
+        return -1;
+    }
+    setGLAttributes();
+    SDL_Window* window = SDL_CreateWindow("ORKinect depth shader check", camW, camH, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext gl_context = window ? SDL_GL_CreateContext(window) : NULL;
+    if (gl_context == NULL)
+    {
+        printf("Error: no GL context: %s\n", SDL_GetError());
+        SDL_Quit();
+        return -1;
+    }
+    SDL_GL_MakeCurrent(window, gl_context);
+    printf("%s, %s\n", (const char*)glGetString(GL_RENDERER), (const char*)glGetString(GL_VERSION));
+
+    bool ok = initDepthShader() && checkDepthShader();
+    destroyDepthShader();
+    SDL_GL_DestroyContext(gl_context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return ok ? 0 : 1;
 }
 
 // Main code
-int main(int, char**)
+int main(int argc, char** argv)
 {
-    int iResult = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (!parseArgs(argc, argv)) return 1;
+    if (benchDepth) return benchDepthColor(200) ? 0 : 1;
+    if (benchReplayFrames > 0) return benchReplay(benchReplayFrames);
+    if (benchBodyFrames > 0) return benchBodies(benchBodyFrames);
+    if (benchFilterFrames > 0) return benchFilters(benchFilterFrames);
+    if (benchPredictFrames > 0) return benchPredict(benchPredictFrames);
+    if (benchPrimitiveFrames > 0) return benchPrimitives(benchPrimitiveFrames) ? 0 : 1;
+    if (benchJsonFrames > 0) return benchJson(benchJsonFrames);
+    if (benchBinaryFrames > 0) return benchBinary(benchBinaryFrames);
+    if (checkDeltaFrames > 0) return checkDelta(checkDeltaFrames);
+    if (benchGridFrames > 0) return benchGrid(benchGridFrames);
+    if (receive) return receiveBinary("51677") ? 0 : 1;
+    if (benchSensorCount > 0) return benchSensors(benchSensorCount, syntheticBodies < 0 ? 2 : syntheticBodies) ? 0 : 1;
+    if (checkGpuDepth) return checkDepthShaderMain();
+    if (checkAllocationFrames > 0) return checkAllocations(checkAllocationFrames);
+
+    int iResult = netStartup();
     if (iResult != 0) {
-        wprintf(L"WSAStartup Failed! %d\n", iResult);
+        printf("WSAStartup Failed! %d\n", iResult);
         return 1;
     }
 
@@ -720,7 +1050,7 @@ int main(int, char**)
         * ptr = NULL,
         hints;
 
-    ZeroMemory( &hints, sizeof(hints));
+    memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_INET;
     hints.ai_socktype = SOCK_STREAM;
     hints.ai_protocol = IPPROTO_TCP;
@@ -728,7 +1058,7 @@ int main(int, char**)
     iResult = getaddrinfo("localhost", "51677", &hints, &result);
     if (iResult != 0) {
         printf("getaddrinfo failed with error: %d\n", iResult);
-        WSACleanup();
+        netCleanup();
         return 1;
     }
 
@@ -739,8 +1069,8 @@ int main(int, char**)
         orsock = socket(ptr->ai_family, ptr->ai_socktype,
             ptr->ai_protocol);
         if (orsock == INVALID_SOCKET) {
-            printf("socket failed with error: %ld\n", WSAGetLastError());
-            WSACleanup();
+            printf("socket failed with error: %d\n", WSAGetLastError());
+            netCleanup();
             return 1;
         }
 
@@ -758,10 +1088,15 @@ int main(int, char**)
 
     if (orsock == INVALID_SOCKET) {
         printf("Unable to connect to server!\n");
-        WSACleanup();
+        netCleanup();
         return 1;
     }
 
+    if (headless) {
+        bool ok = runHeadless();
+        return closeConnection() && ok ? 0 : 1;
+    }
+
     // Setup SDL
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
@@ -769,12 +1104,8 @@ int main(int, char**)
         return -1;
     }
 
-    // GL 3.0 + GLSL 130
     const char* glsl_version = "#version 130";
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+    setGLAttributes();
 
     // Create window with graphics context
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
@@ -808,48 +1139,40 @@ int main(int, char**)
     ImGui_ImplOpenGL3_Init(glsl_version);
 
     // Initialize Kinect
-    kinectConnected = initKinect();
+    kinectConnected = initSource();
 
     // Our state
     ImVec4 clear_color = ImVec4(0.f, 0.f, 0.f, 1.00f);
-    float headCSpeedX = 3.21;
-    float headCSpeedY = 3.21;
-    float headCSpeedZ = 3.21;
-
-    float headISpeedX = -3.21/2;
-    float headISpeedY = -3.21/2;
-    float headISpeedZ = -3.21/2;
 
-    float handCSpeedX = 2.13;
-    float handCSpeedY = 2.13;
-    float handCSpeedZ = 2.13;
+    // Stream choices in the UI, applied by reopening the sensors
+    int depthMode = streams.depth + 1;
+    int colorMode = streams.color == RESOLUTION_OFF ? 0 : streams.color - 1;
 
-    float footCSpeedX = 2.23;
-    float footCSpeedY = 2.23;
-    float footCSpeedZ = 2.23;
-
-    // Initialize textures
+    // Initialize textures, their storage is sized by the first frame of each stream
     glGenTextures(1, &texIDD);
     glBindTexture(GL_TEXTURE_2D, texIDD);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, camW, camH,
-        0, GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)dataD);
     glBindTexture(GL_TEXTURE_2D, 0);
 
     glGenTextures(1, &texIDC);
     glBindTexture(GL_TEXTURE_2D, texIDC);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, camW, camH,
-        0, GL_BGRA, GL_UNSIGNED_BYTE, (GLvoid*)dataC);
     glBindTexture(GL_TEXTURE_2D, 0);
 
+    // The CPU conversion stays as the fallback when the shader isn't available
+    depthShaderReady = initDepthShader();
+    gpuDepth = depthShaderReady;
+
     int frameCounter = 0;
     // Main loop
     bool done = false;
     while (!done)
     {
+        // Nobody sees the UI numbers while minimized
+        updateStageLoad(SDL_GetWindowFlags(window) & SDL_WINDOW_MINIMIZED);
+
         SDL_Event event;
         while (SDL_PollEvent(&event))
         {
@@ -863,26 +1186,20 @@ int main(int, char**)
         const static int divider = 4;
         float delt = io.DeltaTime * divider;
         frameCounter = (frameCounter + 1) % divider;
+        bool outputNow = outputRate > 0 ? outputDue(delt) : frameCounter == 0;
 
         if (SDL_GetWindowFlags(window) & SDL_WINDOW_MINIMIZED)
         {
-            getKinectData(dataD, dataC);
-            if (frameCounter == 0) {
-                headCubeRotation = headCubeRotation + glm::vec3({ headCSpeedX * delt, headCSpeedY * delt, headCSpeedZ * delt });
-                headIcoRotation = headIcoRotation + glm::vec3({ headISpeedX * delt, headISpeedY * delt, headISpeedZ * delt });
-
-                handCubeRotationL = handCubeRotationL + glm::vec3({ handCSpeedX * delt, handCSpeedY * delt, handCSpeedZ * delt });
-                handCubeRotationR = handCubeRotationR + glm::vec3({ -handCSpeedX * delt, -handCSpeedY * delt, -handCSpeedZ * delt });
-
-                footCubeRotationL = footCubeRotationL + glm::vec3({ footCSpeedX * delt, footCSpeedY * delt, footCSpeedZ * delt });
-                footCubeRotationR = footCubeRotationR + glm::vec3({ -footCSpeedX * delt, -footCSpeedY * delt, -footCSpeedZ * delt });
-
-                makeJson();
-                iResult = sendOsciRender();
+            updateRenderDemand(false);
+            ingestFrames();
+            if (outputNow) {
+                spinPrimitives(delt);
+                iResult = outputJson();
                 if (iResult != 0) {
-                    wprintf(L"Sending data failed! code %d\n", iResult);
+                    printf("Sending data failed! code %d\n", iResult);
                     closesocket(orsock);
-                    WSACleanup();
+                    netCleanup();
+                    KinectCleanup();
                     SDLCleanup(gl_context, window);
                     return 1;
                 }
@@ -908,9 +1225,75 @@ int main(int, char**)
 
             ImGui::SliderFloat("Skeleton Z Distance", &slide, -5, 5);
 
+            // The sliders set every joint at once, starting from the first joint's values
+            JointFilterSettings& filter = jointFilterSettings;
+            const char* filters[] = { "None", "One-Euro", "Double Exponential" };
+            ImGui::Combo("Joint Filter", (int*)&filter.type, filters, IM_ARRAYSIZE(filters));
+            if (filter.type == FILTER_ONE_EURO) {
+                float minCutoff = filter.minCutoff[0], beta = filter.beta[0];
+                bool changed = ImGui::SliderFloat("Min Cutoff (Hz)", &minCutoff, 0.1f, 10);
+                changed |= ImGui::SliderFloat("Beta", &beta, 0, 10);
+                if (changed) setOneEuro(filter, -1, minCutoff, beta, filter.derivativeCutoff[0]);
+            }
+            if (filter.type == FILTER_DOUBLE_EXPONENTIAL) {
+                float smoothing = filter.smoothing[0], correction = filter.correction[0], prediction = filter.prediction[0];
+                bool changed = ImGui::SliderFloat("Smoothing", &smoothing, 0, 0.95f);
+                changed |= ImGui::SliderFloat("Correction", &correction, 0, 1);
+                changed |= ImGui::SliderFloat("Prediction", &prediction, 0, 2);
+                if (changed) setDoubleExponential(filter, -1, smoothing, correction, prediction, filter.jitterRadius[0], filter.maxDeviationRadius[0]);
+            }
+
+            ImGui::Checkbox("Predict Joints", &prediction.enabled);
+            if (prediction.enabled) {
+                ImGui::SliderFloat("Extra Latency (ms)", &prediction.extraMs, 0, 200);
+                ImGui::Checkbox("Use Acceleration", &prediction.acceleration);
+            }
+
+            // 0 keeps the old every 4th frame, the window's frame rate caps the rest
+            ImGui::SliderFloat("Output Rate (Hz)", &outputRate, 0, 120);
+            const char* interpolations[] = { "None", "Linear", "Catmull-Rom" };
+            ImGui::Combo("Interpolation", (int*)&interpolation, interpolations, IM_ARRAYSIZE(interpolations));
+            ImGui::Checkbox("Send Frame Info", &sendFrameInfo);
+            ImGui::SliderFloat("Output Grid (mm)", &gridMm, 0, 5);
+
+            const char* colormaps[] = { "Wrapped", "Grayscale", "Banded", "False Color" };
+            ImGui::Combo("Depth View", (int*)&depthColor.colormap, colormaps, IM_ARRAYSIZE(colormaps));
+            ImGui::DragIntRange2("Depth Range (mm)", &depthColor.nearMm, &depthColor.farMm, 10, 0, 8000);
+            if (depthColor.colormap == DEPTH_BANDED) ImGui::SliderInt("Band Width (mm)", &depthColor.bandMm, 10, 1000);
+            if (depthShaderReady) ImGui::Checkbox("GPU Depth View", &gpuDepth);
+
+            const char* depthModes[] = { "Off", "80x60", "320x240", "640x480" };
+            const char* colorModes[] = { "Off", "640x480 @ 30 fps", "1280x960 @ 12 fps" };
+            ImGui::Combo("Depth Stream", &depthMode, depthModes, IM_ARRAYSIZE(depthModes));
+            ImGui::Combo("Color Stream", &colorMode, colorModes, IM_ARRAYSIZE(colorModes));
+            Resolution depthChoice = (Resolution)(depthMode - 1);
+            Resolution colorChoice = colorMode == 0 ? RESOLUTION_OFF : (Resolution)(colorMode + 1);
+            if ((depthChoice != streams.depth || colorChoice != streams.color) && ImGui::Button("Apply Streams")) {
+                streams.depth = depthChoice;
+                streams.color = colorChoice;
+                restartSensors();
+            }
+
+            if (sensorCount > 1) {
+                ImGui::SliderInt("View Sensor", &viewSensor, 0, sensorCount - 1);
+                for (int i = 0; i < sensorCount; i++) {
+                    ImGui::PushID(i);
+                    ImGui::Text("Sensor %d", i);
+                    ImGui::DragFloat3("Position (m)", &sensors[i].position.x, 0.01f);
+                    ImGui::SliderFloat("Yaw", &sensors[i].yaw, -180, 180);
+                    ImGui::PopID();
+                }
+            }
+
             ImGui::SetWindowFontScale(1.5);
             ImGui::Text("Skeletons Tracked: %d", activeSkeletons);
+            ImGui::Text("Output latency %.1f ms, predicting %.1f ms ahead", outputLatencyMs, predictionMs);
+            ImGui::Text("Skeleton frame %u at %.3f s sensor time", bodies.frameNumber, bodies.timestamp / 1000.0);
+            ImGui::Text("Dropped by sensor/unread: depth %llu/%llu, color %llu/%llu, skeleton %llu/%llu",
+                sensorDropped(STREAM_DEPTH), unreadFrames[0], sensorDropped(STREAM_COLOR), unreadFrames[1], sensorDropped(STREAM_SKELETON), unreadFrames[2]);
             ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+            ImGui::Text("CPU %%: capture %.1f, record %.1f, ingest %.1f, output %.1f, render %.1f",
+                stageLoad[STAGE_CAPTURE], stageLoad[STAGE_RECORD], stageLoad[STAGE_INGEST], stageLoad[STAGE_OUTPUT], stageLoad[STAGE_RENDER]);
             ImGui::End();
         }
 
@@ -920,25 +1303,18 @@ int main(int, char**)
         glClearColor(clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w);
         glClear(GL_COLOR_BUFFER_BIT);
         // Draw Kinect Data
-        getKinectData(dataD, dataC);
+        updateRenderDemand(true);
+        ingestFrames();
         drawKinectData();
 
-        if (frameCounter == 0) {
-            headCubeRotation = headCubeRotation + glm::vec3({ headCSpeedX * delt, headCSpeedY * delt, headCSpeedZ * delt });
-            headIcoRotation = headIcoRotation + glm::vec3({ headISpeedX * delt, headISpeedY * delt, headISpeedZ * delt });
-
-            handCubeRotationL = handCubeRotationL + glm::vec3({ handCSpeedX * delt, handCSpeedY * delt, handCSpeedZ * delt });
-            handCubeRotationR = handCubeRotationR + glm::vec3({ -handCSpeedX * delt, -handCSpeedY * delt, -handCSpeedZ * delt });
-
-            footCubeRotationL = footCubeRotationL + glm::vec3({ footCSpeedX * delt, footCSpeedY * delt, footCSpeedZ * delt });
-            footCubeRotationR = footCubeRotationR + glm::vec3({ -footCSpeedX * delt, -footCSpeedY * delt, -footCSpeedZ * delt });
-
-            makeJson();
-            iResult = sendOsciRender();
+        if (outputNow) {
+            spinPrimitives(delt);
+            iResult = outputJson();
             if (iResult != 0) {
-                wprintf(L"Sending data failed! code %d\n", iResult);
+                printf("Sending data failed! code %d\n", iResult);
                 closesocket(orsock);
-                WSACleanup();
+                netCleanup();
+                KinectCleanup();
                 SDLCleanup(gl_context, window);
                 return 1;
             }
@@ -948,19 +1324,10 @@ int main(int, char**)
         SDL_GL_SwapWindow(window);
     }
 
-    std::string close = "CLOSE\n";
-    send(orsock, close.c_str(), close.length(), 0);
-    shutdown(orsock, 2);
-    iResult = closesocket(orsock);
-    if (iResult == SOCKET_ERROR) {
-        wprintf(L"closesocket failed with error = %d\n", WSAGetLastError());
-        WSACleanup();
-        SDLCleanup(gl_context, window);
-        return 1;
-    }
-    WSACleanup();
+    bool closed = closeConnection();
 
+    KinectCleanup();
     SDLCleanup(gl_context, window);
 
-    return 0;
+    return closed ? 0 : 1;
 }